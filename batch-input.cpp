@@ -0,0 +1,146 @@
+/*
+  File: batch-input.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Scripts of commands are handed out a line at a time from one buffer. Regular
+// files are mapped in whole, so nothing is copied. Pipes are read into the
+// buffer in large blocks as the lines get used up.
+
+#define LineReaderBlockSize Megabytes(1)
+
+// A command is handed to the tokenizer as a string, whose length is an
+// int_size, so longer lines stop the script with an error
+#define LineReaderMaxLineLength Megabytes(512)
+
+struct line_reader {
+    s32 FileDescriptor;
+    b32 IsMapped;
+    b32 AtEndOfInput;
+
+    // Mapped files can be larger than an int_size holds
+    char* Contents;
+    s64 Start;  // First character not handed out yet
+    s64 Length; // Characters in Contents
+    s64 Capacity;
+
+    char const* Error; // Why the input stopped before its end, or NULL
+};
+
+// Filename "-" reads from stdin. Returns false if the file can't be opened.
+internal b32
+OpenLineReader(char const* Filename, line_reader* Reader) {
+    ClearBytes(Reader, sizeof(*Reader));
+
+    if(Filename[0] == '-' && Filename[1] == 0) {
+        Reader->FileDescriptor = STDIN_FILENO;
+    } else {
+        Reader->FileDescriptor = open(Filename, O_RDONLY);
+    }
+
+    b32 Result = (Reader->FileDescriptor >= 0);
+    if(Result) {
+        struct stat FileInfo = {};
+        if(fstat(Reader->FileDescriptor, &FileInfo) == 0 && S_ISREG(FileInfo.st_mode) && FileInfo.st_size > 0) {
+            void* Mapping = mmap(NULL, FileInfo.st_size, PROT_READ, MAP_PRIVATE, Reader->FileDescriptor, 0);
+            if(Mapping != MAP_FAILED) {
+                madvise(Mapping, FileInfo.st_size, MADV_SEQUENTIAL);
+                Reader->Contents = (char*)Mapping;
+                Reader->Length = (s64)FileInfo.st_size;
+                Reader->Capacity = (s64)FileInfo.st_size;
+                Reader->IsMapped = true;
+                Reader->AtEndOfInput = true;
+            }
+        }
+
+        if(!Reader->IsMapped) {
+            Reader->Contents = AllocateOnHeapTyped<char>(LineReaderBlockSize);
+            Reader->Capacity = LineReaderBlockSize;
+        }
+    }
+
+    return Result;
+}
+
+internal void
+CloseLineReader(line_reader* Reader) {
+    if(Reader->IsMapped) {
+        munmap(Reader->Contents, Reader->Capacity);
+    } else {
+        DeallocateHeap(Reader->Contents);
+    }
+
+    if(Reader->FileDescriptor > STDIN_FILENO) {
+        close(Reader->FileDescriptor);
+    }
+    ClearBytes(Reader, sizeof(*Reader));
+}
+
+// The line points into the reader's buffer and is good until the next call.
+// It doesn't include the line break, and a trailing \r is left off as well.
+// Returns false at the end of the input, or when it can't go on, in which case
+// Error says why.
+internal b32
+ReadLine(line_reader* Reader, string* Line) {
+    b32 Result = false;
+    s64 Searched = 0; // Characters of the line already known not to be a line break
+    for(;;) {
+        char* Start = Reader->Contents + Reader->Start;
+        s64 Remaining = Reader->Length - Reader->Start;
+
+        char* LineEnd = (char*)memchr(Start + Searched, '\n', Remaining - Searched);
+        Searched = Remaining;
+        if(LineEnd == NULL && Reader->AtEndOfInput) {
+            // Last line, which might not have a line break
+            LineEnd = Start + Remaining;
+        }
+
+        if(LineEnd && LineEnd - Start > LineReaderMaxLineLength) {
+            Reader->Error = "Line is too long";
+            break;
+        }
+
+        if(LineEnd) {
+            Result = (Remaining > 0);
+            Reader->Start = LineEnd - Reader->Contents;
+            if(Reader->Start < Reader->Length) {
+                ++Reader->Start; // Past the line break
+            }
+            if(LineEnd > Start && LineEnd[-1] == '\r') {
+                --LineEnd;
+            }
+            *Line = StringWithLength(Start, (int_size)(LineEnd - Start));
+            break;
+        }
+
+        // Keep the partial line at the front of the buffer and read more after it
+        memmove(Reader->Contents, Start, Remaining);
+        Reader->Start = 0;
+        Reader->Length = Remaining;
+        if(Reader->Length == Reader->Capacity) {
+            // The line is longer than the whole buffer
+            if(Reader->Capacity >= LineReaderMaxLineLength) {
+                Reader->Error = "Line is too long";
+                break;
+            }
+            Reader->Capacity *= 2;
+            Reader->Contents = (char*)ReallocateOnHeap(Reader->Contents, (int_size)Reader->Capacity);
+        }
+
+        ssize_t NumRead = read(Reader->FileDescriptor, Reader->Contents + Reader->Length, Reader->Capacity - Reader->Length);
+        if(NumRead > 0) {
+            Reader->Length += NumRead;
+        } else if(NumRead < 0 && errno == EINTR) {
+            // Interrupted before anything came in, so try again
+        } else if(NumRead < 0) {
+            Reader->Error = strerror(errno);
+            break;
+        } else {
+            Reader->AtEndOfInput = true;
+        }
+    }
+
+    return Result;
+}
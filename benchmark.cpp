@@ -0,0 +1,297 @@
+/*
+  File: benchmark.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Microbenchmarks for the random engines, the dice kernels and the tokenizer. Build and run
+// with `./compile bench`. Prints CSV by default or JSON with --json, one
+// record per measurement, so runs can be diffed between versions.
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "common_defs.h"
+#include "basic_types.h"
+
+#include "common_operations.cpp"
+#include "symbols.cpp"
+#include "dice-cmd.cpp"
+#include "random.cpp"
+#include "dice-roll.cpp"
+
+// Stops the compiler from removing work whose result is never used
+global volatile u64 BenchmarkSink;
+
+global r64 MinSecondsPerBenchmark = 0.2;
+global b32 OutputJSON;
+global b32 IsFirstRecord = true;
+
+struct benchmark_result {
+    s64 NumValues;
+    r64 Seconds;
+};
+
+internal r64
+CurrentSeconds() {
+    struct timespec Now = {};
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    r64 Result = (r64)Now.tv_sec + (r64)Now.tv_nsec * 1e-9;
+    return Result;
+}
+
+// Calls Body (which reports how many values it made) until enough time passes
+template<class body> internal benchmark_result
+RunBenchmark(body Body) {
+    benchmark_result Result = {};
+
+    // Warm up caches and branch predictors
+    Body();
+
+    r64 Start = CurrentSeconds();
+    do {
+        Result.NumValues += Body();
+        Result.Seconds = CurrentSeconds() - Start;
+    } while(Result.Seconds < MinSecondsPerBenchmark);
+
+    return Result;
+}
+
+internal void
+PrintRecord(char const* Benchmark, char const* Engine, char const* Parameter, s64 BatchSize, benchmark_result Result) {
+    r64 NanosecondsPerValue = Result.Seconds * 1e9 / (r64)Result.NumValues;
+    r64 ValuesPerSecond = (r64)Result.NumValues / Result.Seconds;
+
+    if(OutputJSON) {
+        printf("%s\n  {\"benchmark\": \"%s\", \"engine\": \"%s\", \"parameter\": \"%s\", \"batch\": %lld, "
+               "\"ns_per_value\": %.4f, \"values_per_sec\": %.0f}",
+               IsFirstRecord ? "[" : ",", Benchmark, Engine, Parameter, (long long)BatchSize,
+               NanosecondsPerValue, ValuesPerSecond);
+    } else {
+        if(IsFirstRecord) {
+            printf("benchmark,engine,parameter,batch,ns_per_value,values_per_sec\n");
+        }
+        printf("%s,%s,%s,%lld,%.4f,%.0f\n", Benchmark, Engine, Parameter, (long long)BatchSize,
+               NanosecondsPerValue, ValuesPerSecond);
+    }
+    fflush(stdout);
+
+    IsFirstRecord = false;
+}
+
+#define BatchSize 4096
+
+global u32 Batch[BatchSize];
+
+template<class random_state> internal void
+BenchmarkEngine(char const* Name, random_state* RandomState) {
+    PrintRecord("next", Name, "", 1, RunBenchmark([&]() {
+        u64 Sum = 0;
+        for(s32 Index = 0; Index < BatchSize; ++Index) {
+            Sum += NextRandom(RandomState);
+        }
+        BenchmarkSink += Sum;
+        return (s64)BatchSize;
+    }));
+
+    PrintRecord("fill", Name, "", BatchSize, RunBenchmark([&]() {
+        FillRandom(Batch, BatchSize, RandomState);
+        BenchmarkSink += Batch[BatchSize - 1];
+        return (s64)BatchSize;
+    }));
+
+    PrintRecord("make_random_array", Name, "", BatchSize, RunBenchmark([&]() {
+        MakeRandomArray(BatchSize, Batch, RandomState);
+        BenchmarkSink += Batch[0];
+        return (s64)BatchSize;
+    }));
+
+    PrintRecord("shuffle_array", Name, "", BatchSize, RunBenchmark([&]() {
+        ShuffleArray(BatchSize, Batch, RandomState);
+        BenchmarkSink += Batch[0];
+        return (s64)BatchSize;
+    }));
+
+    s32 const SideCounts[] = { 2, 4, 6, 8, 10, 12, 20, 97, 100, 1000 };
+    s32 const PoolSizes[] = { 1, 3, 100, BatchSize };
+    for(s32 SideIndex = 0; SideIndex < (s32)ArrayLength(SideCounts); ++SideIndex) {
+        for(s32 PoolIndex = 0; PoolIndex < (s32)ArrayLength(PoolSizes); ++PoolIndex) {
+            s32 NumSides = SideCounts[SideIndex];
+            s32 PoolSize = PoolSizes[PoolIndex];
+
+            char Parameter[32];
+            snprintf(Parameter, sizeof(Parameter), "d%d", NumSides);
+            PrintRecord("roll_dice", Name, Parameter, PoolSize, RunBenchmark([&]() {
+                s64 NumValues = 0;
+                while(NumValues < BatchSize) {
+                    RollDice(RandomState, NumSides, PoolSize, Batch);
+                    NumValues += PoolSize;
+                }
+                BenchmarkSink += Batch[0];
+                return NumValues;
+            }));
+        }
+    }
+}
+
+// The Wichmann-Hill generators give floats, so they only have the single value test
+template<class random_state> internal void
+BenchmarkFloatEngine(char const* Name, random_state* RandomState) {
+    PrintRecord("next", Name, "", 1, RunBenchmark([&]() {
+        r32 Sum = 0;
+        for(s32 Index = 0; Index < BatchSize; ++Index) {
+            Sum += NextRandom(RandomState);
+        }
+        BenchmarkSink += (u64)Sum;
+        return (s64)BatchSize;
+    }));
+}
+
+// --- Tokenizer
+
+#define TokenizerInputSize Megabytes(16)
+
+// Lines like the ones a script would send, with some mistakes mixed in. With a
+// ColumnWidth every piece is padded out to the next column, the way generated
+// files line things up; otherwise pieces are split by a single space.
+internal array<char>
+MakeTokenizerInput(s64 Size, s64 ColumnWidth) {
+    char const* Pieces[] = {
+        "3d6", "d20", "2d10", "1000d6", "12d8", "123456789d20", "D4", "d", "0d6", "3d0", "3d6x",
+        "4d6kh3", "2d20KL1", "4d6kh", "3d6kh4", "adv", "dis",
+        "6d6!", "4d6r1", "4d6r2kh3", "10d10#>=7", "5d10!#>8", "3d6#<3", "d6r6", "d2r1!", "4d6!kh3",
+        "4", "100", "20", "99999999999", "2.5", "abc12", "sim", "dist", "quit", "exit", "remove", "attack", "Sim", "\"label\"",
+        "+", "-", "*", "/", ">=", "<", "(", ")", ";", "\n", "  ", "\t",
+    };
+
+    array<char> Result = AllocateArray<char>((int_size)Size);
+    pcg_random_state RandomState = PCGSeed(0x70CE);
+
+    s64 Length = 0;
+    for(;;) {
+        char const* Piece = Pieces[NextBounded(&RandomState, ArrayLength(Pieces))];
+        s64 PieceLength = (s64)strlen(Piece);
+        s64 Padding = 1;
+        if(ColumnWidth > 0) {
+            Padding = ColumnWidth - PieceLength % ColumnWidth;
+        }
+        if(Length + PieceLength + Padding + 1 > Size) {
+            break;
+        }
+
+        memcpy(Result.Contents + Length, Piece, PieceLength);
+        Length += PieceLength;
+        memset(Result.Contents + Length, ' ', Padding);
+        Length += Padding;
+    }
+    Result.Contents[Length] = 0;
+    Result.Length = (int_size)Length;
+
+    return Result;
+}
+
+internal tokenizer
+MakeTokenizer(array<char> Input, memory_arena* Arena) {
+    tokenizer Result = {};
+    Result.At = Input.Contents;
+    Result.End = Input.Contents + Input.Length;
+    Result.Arena = Arena;
+    Result.Symbols = NewSymbolTable(Arena);
+    return Result;
+}
+
+internal void
+BenchmarkTokenizer(char const* InputName, array<char> Input, memory_arena* Arena) {
+    char Parameter[32];
+    snprintf(Parameter, sizeof(Parameter), "%s_%lldMB", InputName, (long long)((Input.Length + Megabytes(1) / 2) / Megabytes(1)));
+
+    PrintRecord("tokenize", "get_token", Parameter, Input.Length, RunBenchmark([&]() {
+        tokenizer Tokenizer = MakeTokenizer(Input, Arena);
+        u64 NumTokens = 0;
+        while(GetToken(&Tokenizer).Type != TokenTypeEndOfStream) {
+            ++NumTokens;
+        }
+        BenchmarkSink += NumTokens;
+        ResetArena(Arena);
+        return (s64)Input.Length;
+    }));
+}
+
+internal void
+PrintUsage(char const* ProgramName) {
+    fprintf(stderr,
+            "Usage: %s [--json] [--min-time SECONDS]\n"
+            "  --json              Print JSON instead of CSV\n"
+            "  --min-time SECONDS  Minimum time spent on each measurement. Defaults to 0.2.\n",
+            ProgramName);
+}
+
+s32 main(s32 ArgCount, char** Args) {
+    for(s32 ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex) {
+        string Arg = StringFromC(Args[ArgIndex]);
+        if(StringsEqual(Arg, String("--json"))) {
+            OutputJSON = true;
+        } else if(StringsEqual(Arg, String("--min-time")) && ArgIndex + 1 < ArgCount) {
+            MinSecondsPerBenchmark = atof(Args[++ArgIndex]);
+        } else {
+            PrintUsage(Args[0]);
+            return 1;
+        }
+    }
+
+    u64 Seed = 0x5EED;
+
+    pcg_random_state PCG = PCGSeed(Seed);
+    BenchmarkEngine("pcg_scalar", &PCG);
+
+    char const* SIMDLevelNames[] = { "pcg_multi_scalar", "pcg_multi_sse2", "pcg_multi_avx2", "pcg_multi_avx512" };
+    for(s32 Level = SIMDLevelScalar; Level <= SIMDLevelAVX512; ++Level) {
+        // Skip levels the CPU doesn't have instead of measuring a lower one twice
+        if(SetPCGSIMDLevel((simd_level)Level) == Level) {
+            pcg_multi_random_state PCGMulti = PCGMultiSeed(Seed);
+            BenchmarkEngine(SIMDLevelNames[Level], &PCGMulti);
+        }
+    }
+    InitPCGSIMDLevel();
+
+    xoshiro_random_state Xoshiro = XoshiroSeed(Seed);
+    BenchmarkEngine("xoshiro", &Xoshiro);
+
+    philox_random_state Philox = PhiloxSeed(Seed);
+    BenchmarkEngine("philox", &Philox);
+
+    standard_c_random_state StandardC = StandardCRNGSeed((u32)Seed);
+    BenchmarkEngine("libc", &StandardC);
+
+    wichmann_hill_random_state1 WichmannHill1 = { 1, 2, 3 };
+    BenchmarkFloatEngine("wichmann_hill1", &WichmannHill1);
+
+    wichmann_hill_random_state2 WichmannHill2 = { 1, 2, 3, 4 };
+    BenchmarkFloatEngine("wichmann_hill2", &WichmannHill2);
+
+    memory_arena Arena = {};
+    s64 ColumnWidths[] = { 0, 16 };
+    char const* InputNames[] = { "spaced", "aligned" };
+    for(s32 InputIndex = 0; InputIndex < ArrayLength(ColumnWidths); ++InputIndex) {
+        array<char> Input = MakeTokenizerInput(TokenizerInputSize, ColumnWidths[InputIndex]);
+        BenchmarkTokenizer(InputNames[InputIndex], Input, &Arena);
+        Deallocate(Input);
+    }
+    FreeArena(&Arena);
+
+    if(OutputJSON) {
+        printf("\n]\n");
+    }
+
+    return 0;
+}
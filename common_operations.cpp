@@ -32,6 +32,22 @@ StringToIntUnchecked(string String) {
     return Result;
 }
 
+// Like StringToIntUnchecked, but returns false instead of wrapping around when
+// the digits don't fit in an int_size
+internal b32
+StringToInt(string String, int_size* Value) {
+    b32 Result = true;
+    int_size Number = 0;
+
+    for(int_size Index = 0; Index < String.Length && Result; ++Index) {
+        Result = !__builtin_mul_overflow(Number, 10, &Number) &&
+                 !__builtin_add_overflow(Number, String.Contents[Index] - '0', &Number);
+    }
+
+    *Value = Number;
+    return Result;
+}
+
 internal void*
 AllocateOnHeap(int_size Size) {
     // printf("Allocating %d on heap\n", Size);
@@ -39,11 +55,25 @@ AllocateOnHeap(int_size Size) {
     return Result;
 }
 
+// Alignment must be a power of 2. Free with DeallocateHeap.
+internal void*
+AllocateOnHeapAligned(int_size Size, int_size Alignment) {
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t RoundedSize = ((size_t)Size + Alignment - 1) & ~((size_t)Alignment - 1);
+    void* Result = aligned_alloc(Alignment, RoundedSize);
+    return Result;
+}
+
 #ifdef __cplusplus
 template<class type> internal type*
 AllocateOnHeapTyped(int_size Count = 1, int_size Extra = 0) {
     // printf("Allocating %d on heap\n", Size);
-    type* Result = (type*)AllocateOnHeap(sizeof(type) * Count + Extra);
+    type* Result = NULL;
+    if(alignof(type) > alignof(max_align_t)) {
+        Result = (type*)AllocateOnHeapAligned(sizeof(type) * Count + Extra, alignof(type));
+    } else {
+        Result = (type*)AllocateOnHeap(sizeof(type) * Count + Extra);
+    }
     return Result;
 }
 #endif
@@ -64,6 +94,127 @@ ReallocateOnHeap(void* Existing, int_size Size) {
     return Result;
 }
 
+// --- Arenas
+//
+// Memory handed out by moving a pointer forward. Nothing is freed on its own;
+// ResetArena gives back everything at once. When an arena runs out it chains
+// on a new block, and the next reset swaps the chain for one block big enough
+// for all of it, so an arena that is reset regularly settles on one block and
+// resetting stays O(1).
+
+struct memory_arena_block {
+    memory_arena_block* Previous;
+    s64 Size; // Bytes after this header
+};
+
+struct memory_arena {
+    memory_arena_block* Block;
+    u8* At;  // Next free byte in Block
+    u8* End;
+    s64 TotalSize; // Of all blocks in the chain
+};
+
+#define MinimumArenaBlockSize (1 << 20)
+
+internal void
+AddArenaBlock(memory_arena* Arena, s64 Size) {
+    if(Size < MinimumArenaBlockSize) {
+        Size = MinimumArenaBlockSize;
+    }
+
+    memory_arena_block* Block = (memory_arena_block*)AllocateOnHeapAligned(sizeof(memory_arena_block) + Size, 64);
+    Block->Previous = Arena->Block;
+    Block->Size = Size;
+
+    Arena->Block = Block;
+    Arena->At = (u8*)(Block + 1);
+    Arena->End = Arena->At + Size;
+    Arena->TotalSize += Size;
+}
+
+// Alignment must be a power of 2
+internal void*
+PushSize(memory_arena* Arena, s64 Size, s64 Alignment = 16) {
+    uintptr_t Start = ((uintptr_t)Arena->At + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    if(Arena->Block == NULL || Start + Size > (uintptr_t)Arena->End) {
+        AddArenaBlock(Arena, Size + Alignment);
+        Start = ((uintptr_t)Arena->At + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    }
+
+    Arena->At = (u8*)(Start + Size);
+    return (void*)Start;
+}
+
+internal void
+FreeArena(memory_arena* Arena) {
+    memory_arena_block* Block = Arena->Block;
+    while(Block) {
+        memory_arena_block* Previous = Block->Previous;
+        DeallocateHeap(Block);
+        Block = Previous;
+    }
+    ClearBytes(Arena, sizeof(*Arena));
+}
+
+internal void
+ResetArena(memory_arena* Arena) {
+    if(Arena->Block && Arena->Block->Previous) {
+        s64 TotalSize = Arena->TotalSize;
+        FreeArena(Arena);
+        AddArenaBlock(Arena, TotalSize);
+    } else if(Arena->Block) {
+        Arena->At = (u8*)(Arena->Block + 1);
+    }
+}
+
+internal string
+PushString(memory_arena* Arena, string String) {
+    char* Buffer = (char*)PushSize(Arena, String.Length + 1, 1);
+    for(s64 Index = 0; Index < String.Length; ++Index) {
+        Buffer[Index] = String.Contents[Index];
+    }
+    Buffer[String.Length] = 0;
+
+    string Result = StringWithLength(Buffer, String.Length);
+    return Result;
+}
+
+// printf into the arena
+internal string
+PushFormat(memory_arena* Arena, char const* Format, ...) {
+    va_list Args;
+    va_start(Args, Format);
+    s32 Length = vsnprintf(NULL, 0, Format, Args);
+    va_end(Args);
+
+    char* Buffer = (char*)PushSize(Arena, Length + 1, 1);
+    va_start(Args, Format);
+    vsnprintf(Buffer, Length + 1, Format, Args);
+    va_end(Args);
+
+    string Result = StringWithLength(Buffer, Length);
+    return Result;
+}
+
+#ifdef __cplusplus
+template<class type> internal type*
+PushTyped(memory_arena* Arena, s64 Count = 1) {
+    s64 Alignment = alignof(type) > 16 ? alignof(type) : 16;
+    type* Result = (type*)PushSize(Arena, sizeof(type) * Count, Alignment);
+    return Result;
+}
+
+template<class element> internal array<element>
+PushArray(memory_arena* Arena, int_size Length) {
+    array<element> Result = {};
+
+    Result.Length = Length;
+    Result.Contents = PushTyped<element>(Arena, Length);
+
+    return Result;
+}
+#endif
+
 #ifdef __cplusplus
 template<class element> internal array<element> 
 AllocateArray(int_size Length) {
@@ -223,12 +374,39 @@ Reserve(dynamic_array<element>* Array, s64 DesiredSize) {
 
         Assert(NewCapacity >= DesiredSize);
 
-        // TODO: Custom allocation
         Array->Contents = (element*)ReallocateOnHeap(Array->Contents, sizeof(element) * NewCapacity);
         Array->Capacity = NewCapacity;
     }
 }
 
+// Grows the array inside Arena. The old contents stay in the arena until it is
+// reset, which costs at most as much again as the array itself.
+template<class element> internal void
+Reserve(memory_arena* Arena, dynamic_array<element>* Array, s64 DesiredSize) {
+    if(Array->Capacity < DesiredSize) {
+        s64 NewCapacity = Array->Capacity * 2;
+        if(NewCapacity < 16) {
+            NewCapacity = 16;
+        }
+        if(NewCapacity < DesiredSize) {
+            NewCapacity = DesiredSize;
+        }
+
+        element* NewContents = PushTyped<element>(Arena, NewCapacity);
+        for(s64 Index = 0; Index < Array->Length; ++Index) {
+            NewContents[Index] = Array->Contents[Index];
+        }
+        Array->Contents = NewContents;
+        Array->Capacity = NewCapacity;
+    }
+}
+
+template<class type> internal void
+Append(memory_arena* Arena, dynamic_array<type>* Array, type Value) {
+    Reserve(Arena, Array, Array->Length + 1);
+    Array->At(Array->Length++) = Value;
+}
+
 template<class type> internal void
 Append(dynamic_array<type>* Array, type Value) {
     Reserve(Array, Array->Length + 1);
@@ -318,25 +496,178 @@ StringConcat(string String1, string String2, string Result) {
     return ResultIndex;
 }
 
-internal char*
-ReadEntireFile(char const* Filename) {
-    FILE* File = fopen(Filename, "rb");
-    char* Result = {};
+// --- Buffered output
+//
+// Everything a command prints goes into one large buffer that is written out
+// with a single write() when it fills up or FlushOutput is called. Print is for
+// formatted text; the hot paths append numbers with WriteInt and everything else
+// with the Write functions, which skip the format parsing. The prompt flushes
+// before it waits for a key, so a command and the next prompt are one write.
+// Lines end in \r\n because the terminal is in raw mode; when the output is
+// going to a file or pipe those \r are taken out as the buffer is flushed.
+// A buffer that Grows is never written out: it holds everything until the
+// caller takes it, which is how the server collects a reply.
 
-    if(File) {
-        fseek(File, 0, SEEK_END);
-        size_t FileSize = ftell(File);
-        fseek(File, 0, SEEK_SET);
+#define OutputBufferSize Megabytes(1)
 
-        Result = AllocateOnHeapTyped<char>(FileSize + 1);
+struct output_buffer {
+    char* Contents;
+    int_size Length;
+    int_size Capacity;
 
-        fread(Result, FileSize, 1, File);
-        Result[FileSize] = 0;
+    s32 FileDescriptor;
+    b32 StripCarriageReturns;
+    b32 Grows;
+};
 
-        fclose(File);
+global output_buffer Output = { NULL, 0, 0, 1 /* stdout */, false };
+
+internal void
+WriteAll(s32 FileDescriptor, char const* Bytes, int_size Length) {
+    while(Length > 0) {
+        ssize_t Written = write(FileDescriptor, Bytes, Length);
+        if(Written <= 0) {
+            // Nowhere left to put the output (ex. a closed pipe)
+            break;
+        }
+        Bytes += Written;
+        Length -= Written;
     }
+}
 
-    return Result;
+internal void
+RemoveCarriageReturns(output_buffer* Buffer) {
+    char* Read = Buffer->Contents;
+    char* End = Buffer->Contents + Buffer->Length;
+    char* Write = Buffer->Contents;
+    while(Read < End) {
+        char* Found = (char*)memchr(Read, '\r', End - Read);
+        char* RunEnd = Found ? Found : End;
+        memmove(Write, Read, RunEnd - Read);
+        Write += RunEnd - Read;
+        Read = RunEnd + (Found ? 1 : 0);
+    }
+    Buffer->Length = Write - Buffer->Contents;
+}
+
+internal void
+FlushOutput(output_buffer* Buffer) {
+    if(Buffer->StripCarriageReturns) {
+        RemoveCarriageReturns(Buffer);
+    }
+
+    WriteAll(Buffer->FileDescriptor, Buffer->Contents, Buffer->Length);
+    Buffer->Length = 0;
+}
+
+// Makes room for Length more bytes, flushing if they don't fit. Length can be
+// at most OutputBufferSize.
+internal void
+ReserveOutput(output_buffer* Buffer, int_size Length) {
+    if(Buffer->Contents == NULL) {
+        Buffer->Contents = AllocateOnHeapTyped<char>(OutputBufferSize);
+        Buffer->Capacity = OutputBufferSize;
+    }
+
+    if(Buffer->Length + Length > Buffer->Capacity) {
+        if(Buffer->Grows) {
+            while(Buffer->Length + Length > Buffer->Capacity) {
+                Buffer->Capacity *= 2;
+            }
+            Buffer->Contents = (char*)ReallocateOnHeap(Buffer->Contents, Buffer->Capacity);
+        } else {
+            FlushOutput(Buffer);
+        }
+    }
+}
+
+internal void
+WriteOutput(output_buffer* Buffer, char const* Bytes, int_size Length) {
+    while(Length > 0) {
+        int_size Count = Length < OutputBufferSize ? Length : OutputBufferSize;
+        ReserveOutput(Buffer, Count);
+        memcpy(Buffer->Contents + Buffer->Length, Bytes, Count);
+        Buffer->Length += Count;
+        Bytes += Count;
+        Length -= Count;
+    }
+}
+
+#define WriteLiteral(Buffer, Literal) WriteOutput(Buffer, Literal, sizeof(Literal) - 1)
+
+internal void
+WriteByte(output_buffer* Buffer, char Byte) {
+    ReserveOutput(Buffer, 1);
+    Buffer->Contents[Buffer->Length++] = Byte;
+}
+
+internal void
+WriteText(output_buffer* Buffer, string Text) {
+    WriteOutput(Buffer, Text.Contents, Text.Length);
+}
+
+// "00" to "99", so numbers are written two digits at a time
+global char const DigitPairs[201] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// Value in decimal, written straight into the buffer from the last digit back
+internal void
+WriteInt(output_buffer* Buffer, s64 Value) {
+    ReserveOutput(Buffer, 20); // Sign and 19 digits
+
+    char* Out = Buffer->Contents + Buffer->Length;
+    u64 Magnitude = (u64)Value;
+    if(Value < 0) {
+        *Out++ = '-';
+        Magnitude = 0 - Magnitude;
+    }
+
+    int_size NumDigits = 1;
+    for(u64 Limit = 10; Magnitude >= Limit && NumDigits < 20; Limit *= 10) {
+        ++NumDigits;
+    }
+
+    char* At = Out + NumDigits;
+    while(Magnitude >= 100) {
+        u64 Pair = Magnitude % 100;
+        Magnitude /= 100;
+        At -= 2;
+        memcpy(At, DigitPairs + 2 * Pair, 2);
+    }
+    if(Magnitude >= 10) {
+        memcpy(At - 2, DigitPairs + 2 * Magnitude, 2);
+    } else {
+        At[-1] = (char)('0' + Magnitude);
+    }
+
+    Buffer->Length = (Out + NumDigits) - Buffer->Contents;
+}
+
+// printf into the global output buffer
+internal void
+Print(char const* Format, ...) {
+    // Almost every line fits in this much
+    ReserveOutput(&Output, 256);
+
+    va_list Args;
+    va_start(Args, Format);
+    int_size Space = Output.Capacity - Output.Length;
+    int_size Length = vsnprintf(Output.Contents + Output.Length, Space, Format, Args);
+    va_end(Args);
+
+    if(Length < Space) {
+        Output.Length += Length;
+    } else {
+        // Didn't fit, so format it again somewhere big enough
+        char* Temporary = AllocateOnHeapTyped<char>(Length + 1);
+        va_start(Args, Format);
+        vsnprintf(Temporary, Length + 1, Format, Args);
+        va_end(Args);
+
+        WriteOutput(&Output, Temporary, Length);
+        DeallocateHeap(Temporary);
+    }
 }
 
 #ifdef __cplusplus
@@ -380,6 +711,7 @@ RadixSort(array<element> Array, array<element> Buffer, key_fn KeyFn = Identity<e
 
 #undef NumSortKeys
 #undef NumRadixBits
+#undef Mask
 }
 
 #endif
@@ -5,12 +5,6 @@
   Notice: (C) Copyright 2022 by Alexandru Filip. All rights reserved.
 */
 
-struct dice_set {
-    int Count;
-    int NumSides;
-    b32 NumSidesKnown;
-};
-
 enum token_type {
     TokenTypeNone,
     TokenTypeEndOfStream,
@@ -19,10 +13,60 @@ enum token_type {
     TokenTypeInt,
     TokenTypeString,
     TokenTypeIdentifier,
+
+    TokenTypePlus,
+    TokenTypeMinus,
+    TokenTypeGreater,
+    TokenTypeGreaterEqual,
+    TokenTypeLess,
+    TokenTypeLessEqual,
+    TokenTypeStar,
+    TokenTypeSlash,
+    TokenTypeOpenParen,
+    TokenTypeCloseParen,
 };
 
+struct dice_set {
+    int Count;
+    int NumSides;
+    b32 NumSidesKnown;
+
+    // ex. 4d6kh3 keeps the 3 highest. 0 keeps every die.
+    int NumKept;
+    b32 KeepLowest;
+
+    // ex. 4d6r1 rolls dice showing 1 or less again until they show more
+    int RerollBelow;
+
+    // ex. 6d6! rolls another die for every die showing its highest face
+    b32 Explodes;
+
+    // ex. 10d10#>=7 counts the dice showing 7 or more instead of adding them up
+    token_type SuccessComparison; // TokenTypeNone if the dice are added up
+    int SuccessTarget;
+};
+
+// Rolled and added up with nothing else done to them
+internal b32
+IsPlainDice(dice_set Dice) {
+    b32 Result = (Dice.NumKept == 0 && Dice.RerollBelow == 0 && !Dice.Explodes && Dice.SuccessComparison == TokenTypeNone);
+    return Result;
+}
+
+internal b32
+DiceSetsEqual(dice_set A, dice_set B) {
+    b32 Result = (A.Count == B.Count && A.NumSides == B.NumSides && A.NumSidesKnown == B.NumSidesKnown &&
+                  A.NumKept == B.NumKept && A.KeepLowest == B.KeepLowest && A.RerollBelow == B.RerollBelow &&
+                  A.Explodes == B.Explodes && A.SuccessComparison == B.SuccessComparison &&
+                  A.SuccessTarget == B.SuccessTarget);
+    return Result;
+}
+
 struct token {
     token_type Type;
+    string Text; // The characters the token was read from
+
+    symbol Symbol; // For identifiers: the keyword or the interned ID of Identifier
 
     union {
         string ErrorMessage;
@@ -36,6 +80,8 @@ struct token {
 struct tokenizer {
     char* At;
     char* End;
+    memory_arena* Arena; // Error messages are written here
+    symbol_table* Symbols; // Identifiers are interned here, if set
 
     token LastReadToken;
     b32  LastReadIsValid;
@@ -43,8 +89,8 @@ struct tokenizer {
 
 internal token
 GetToken(tokenizer* Tokenizer) {
-    // NOTE: Error messages should be copied onto the heap and strings that are
-    // part of the command should just refer to their places in the buffer.
+    // NOTE: Error messages are written to the tokenizer's arena and strings that
+    // are part of the command just refer to their places in the buffer.
     token Result = {};
 
     if(Tokenizer->LastReadIsValid) {
@@ -56,6 +102,8 @@ GetToken(tokenizer* Tokenizer) {
             ++Tokenizer->At;
         }
 
+        char* TokenStart = Tokenizer->At;
+
         // string ErrorMessage = {};
         if(Tokenizer->At >= Tokenizer->End) {
             Result.Type = TokenTypeEndOfStream;
@@ -77,9 +125,25 @@ GetToken(tokenizer* Tokenizer) {
                     Result.Type = TokenTypeError;
                 }
             } else if(Char == '+') {
+                Result.Type = TokenTypePlus;
                 Tokenizer->At += 1;
             } else if(Char == '-') {
+                Result.Type = TokenTypeMinus;
+                Tokenizer->At += 1;
+            } else if(Char == '*') {
+                Result.Type = TokenTypeStar;
                 Tokenizer->At += 1;
+            } else if(Char == '/') {
+                Result.Type = TokenTypeSlash;
+                Tokenizer->At += 1;
+            } else if(Char == '>' || Char == '<') {
+                b32 HasEquals = Tokenizer->At + 1 < Tokenizer->End && Tokenizer->At[1] == '=';
+                if(Char == '>') {
+                    Result.Type = HasEquals ? TokenTypeGreaterEqual : TokenTypeGreater;
+                } else {
+                    Result.Type = HasEquals ? TokenTypeLessEqual : TokenTypeLess;
+                }
+                Tokenizer->At += HasEquals ? 2 : 1;
             } else if(Char == '{') {
                 // Open bracket token (for arrays)
                 Tokenizer->At += 1;
@@ -90,22 +154,22 @@ GetToken(tokenizer* Tokenizer) {
                 // Colon token (for symbols)
                 Tokenizer->At += 1;
             } else if (Char == '(') {
-                // Open Paren token (for expressions)
+                Result.Type = TokenTypeOpenParen;
                 Tokenizer->At += 1;
             } else if (Char == ')') {
-                // Close Paren token (for expressions)
+                Result.Type = TokenTypeCloseParen;
                 Tokenizer->At += 1;
             } else if(IsNumber(Char) || IsLetter(Char)) {
                 b32 StartsWithNumber = IsNumber(Char);
-                int StartNumber = 0;
                 while(IsNumber(Tokenizer->At[TokenEndIndex])) {
-                    StartNumber *= 10;
-                    StartNumber += Tokenizer->At[TokenEndIndex] - '0';
                     ++TokenEndIndex;
                 }
+                int StartNumber = 0;
+                b32 NumberTooLarge = !StringToInt(StringWithLength(Tokenizer->At, TokenEndIndex), &StartNumber);
 
                 const int FirstIndexAfterNumber = TokenEndIndex;
                 b32 HasLetters = IsLetter(Tokenizer->At[TokenEndIndex]);
+                Char = Tokenizer->At[TokenEndIndex];
                 for(;;) {
                     if(IsNumber(Char)) {
                         // Nothing
@@ -120,11 +184,15 @@ GetToken(tokenizer* Tokenizer) {
                 }
 
                 // TODO: Identifier parsed, check if it is a number or a die format
+                symbol Symbol = KeywordNone;
                 if(!HasLetters) {
                     // Is Number, might be float
                     if(Char == '.') {
                         Result.ErrorMessage = String("Floating point numbers are not currently handled");
                         Result.Type = TokenTypeError;
+                    } else if(NumberTooLarge) {
+                        Result.ErrorMessage = String("Number is too large");
+                        Result.Type = TokenTypeError;
                     } else {
                         // Int
                         Result.Number = StartNumber;
@@ -138,13 +206,53 @@ GetToken(tokenizer* Tokenizer) {
                         while(IsNumber(Tokenizer->At[EndIndex])) {
                             ++EndIndex;
                         }
+                        const int SidesEndIndex = EndIndex;
+
+                        // Optional r suffix with the highest face that is rolled again, which defaults to 1
+                        b32 HasReroll = false;
+                        int RerollBelow = 1;
+                        if((Tokenizer->At[EndIndex] | 0x20) == 'r') {
+                            HasReroll = true;
+                            EndIndex += 1;
+
+                            int StartRerollIndex = EndIndex;
+                            while(IsNumber(Tokenizer->At[EndIndex])) {
+                                ++EndIndex;
+                            }
+                            if(EndIndex > StartRerollIndex) {
+                                NumberTooLarge |= !StringToInt(StringWithLength(Tokenizer->At + StartRerollIndex, EndIndex - StartRerollIndex), &RerollBelow);
+                            }
+                        }
+
+                        // Optional kh/kl suffix with the number of dice kept, which defaults to 1
+                        b32 HasKeep = false;
+                        b32 KeepLowest = false;
+                        int NumKept = 1;
+                        if((Tokenizer->At[EndIndex] | 0x20) == 'k' &&
+                           ((Tokenizer->At[EndIndex + 1] | 0x20) == 'h' || (Tokenizer->At[EndIndex + 1] | 0x20) == 'l')) {
+                            HasKeep = true;
+                            KeepLowest = ((Tokenizer->At[EndIndex + 1] | 0x20) == 'l');
+                            EndIndex += 2;
+
+                            int StartKeepIndex = EndIndex;
+                            while(IsNumber(Tokenizer->At[EndIndex])) {
+                                ++EndIndex;
+                            }
+                            if(EndIndex > StartKeepIndex) {
+                                NumberTooLarge |= !StringToInt(StringWithLength(Tokenizer->At + StartKeepIndex, EndIndex - StartKeepIndex), &NumKept);
+                            }
+                        }
 
                         if(EndIndex == TokenEndIndex) {
                             // Only number after 'd'
-                            string NumSidesString = StringWithLength(Tokenizer->At + StartDiceIndex, TokenEndIndex - StartDiceIndex);
-                            int NumSides = StringToIntUnchecked(NumSidesString);
+                            string NumSidesString = StringWithLength(Tokenizer->At + StartDiceIndex, SidesEndIndex - StartDiceIndex);
+                            int NumSides = 0;
+                            NumberTooLarge |= !StringToInt(NumSidesString, &NumSides);
 
-                            if(NumSides > 0) {
+                            if(NumberTooLarge) {
+                                Result.ErrorMessage = String("Number is too large");
+                                Result.Type = TokenTypeError;
+                            } else if(NumSides > 0) {
                                 if(StartsWithNumber) {
                                     if(StartNumber <= 0) {
                                         Result.ErrorMessage = String("Num dice must be greater than zero");
@@ -156,6 +264,31 @@ GetToken(tokenizer* Tokenizer) {
                                     Result.Dice.Count = 1;
                                 }
 
+                                if(Result.Type == TokenTypeNone && HasKeep) {
+                                    if(NumKept <= 0) {
+                                        Result.ErrorMessage = String("Num kept must be greater than zero");
+                                        Result.Type = TokenTypeError;
+                                    } else if(NumKept > Result.Dice.Count) {
+                                        Result.ErrorMessage = String("Can't keep more dice than are rolled");
+                                        Result.Type = TokenTypeError;
+                                    } else {
+                                        Result.Dice.NumKept = NumKept;
+                                        Result.Dice.KeepLowest = KeepLowest;
+                                    }
+                                }
+
+                                if(Result.Type == TokenTypeNone && HasReroll) {
+                                    if(RerollBelow <= 0) {
+                                        Result.ErrorMessage = String("Rerolled faces must be greater than zero");
+                                        Result.Type = TokenTypeError;
+                                    } else if(RerollBelow >= NumSides) {
+                                        Result.ErrorMessage = String("Can't reroll every face");
+                                        Result.Type = TokenTypeError;
+                                    } else {
+                                        Result.Dice.RerollBelow = RerollBelow;
+                                    }
+                                }
+
                                 if(Result.Type == TokenTypeNone) {
                                     Result.Dice.NumSides = NumSides;
                                     Result.Type = TokenTypeDice;
@@ -167,6 +300,78 @@ GetToken(tokenizer* Tokenizer) {
                             }
                         }
                     }
+
+                    if(Result.Type == TokenTypeNone) {
+                        Symbol = InternSymbol(Tokenizer->Symbols, WordStr);
+                        if(Symbol == KeywordAdv || Symbol == KeywordDis) {
+                            // Advantage and disadvantage: roll 2d20 and keep the higher or the lower
+                            Result.Dice.Count = 2;
+                            Result.Dice.NumSides = 20;
+                            Result.Dice.NumSidesKnown = true;
+                            Result.Dice.NumKept = 1;
+                            Result.Dice.KeepLowest = (Symbol == KeywordDis);
+                            Result.Type = TokenTypeDice;
+                        }
+                    }
+
+                    if(Result.Type == TokenTypeDice) {
+                        // These have to come right after the dice. Counting successes
+                        // is marked with '#' so that a comparison on its own always
+                        // compares the total, with or without spaces (ex. 3d6>=10).
+                        dice_set* Dice = &Result.Dice;
+                        if(Tokenizer->At[TokenEndIndex] == '!') {
+                            Dice->Explodes = true;
+                            ++TokenEndIndex;
+                        }
+
+                        b32 MissingSuccessTarget = false;
+                        if(Tokenizer->At[TokenEndIndex] == '#') {
+                            MissingSuccessTarget = true;
+                            ++TokenEndIndex;
+
+                            char Comparison = Tokenizer->At[TokenEndIndex];
+                            if(Comparison == '>' || Comparison == '<') {
+                                int TargetIndex = TokenEndIndex + 1;
+                                b32 OrEqual = (Tokenizer->At[TargetIndex] == '=');
+                                if(OrEqual) {
+                                    ++TargetIndex;
+                                }
+
+                                int TargetEndIndex = TargetIndex;
+                                while(IsNumber(Tokenizer->At[TargetEndIndex])) {
+                                    ++TargetEndIndex;
+                                }
+
+                                if(TargetEndIndex > TargetIndex && !IsLetter(Tokenizer->At[TargetEndIndex])) {
+                                    MissingSuccessTarget = false;
+                                    if(Comparison == '>') {
+                                        Dice->SuccessComparison = OrEqual ? TokenTypeGreaterEqual : TokenTypeGreater;
+                                    } else {
+                                        Dice->SuccessComparison = OrEqual ? TokenTypeLessEqual : TokenTypeLess;
+                                    }
+                                    NumberTooLarge |= !StringToInt(StringWithLength(Tokenizer->At + TargetIndex, TargetEndIndex - TargetIndex), &Dice->SuccessTarget);
+                                    TokenEndIndex = TargetEndIndex;
+                                }
+                            }
+                        }
+
+                        if(MissingSuccessTarget) {
+                            Result.ErrorMessage = String("Expected a comparison and a number after '#'");
+                            Result.Type = TokenTypeError;
+                        } else if(NumberTooLarge) {
+                            Result.ErrorMessage = String("Number is too large");
+                            Result.Type = TokenTypeError;
+                        } else if(Dice->Explodes && Dice->NumKept > 0) {
+                            Result.ErrorMessage = String("Can't keep dice that explode");
+                            Result.Type = TokenTypeError;
+                        } else if(Dice->SuccessComparison != TokenTypeNone && Dice->NumKept > 0) {
+                            Result.ErrorMessage = String("Can't keep dice while counting successes");
+                            Result.Type = TokenTypeError;
+                        } else if(Dice->Explodes && Dice->NumSides - Dice->RerollBelow < 2) {
+                            Result.ErrorMessage = String("Dice that always explode can't be rolled");
+                            Result.Type = TokenTypeError;
+                        }
+                    }
                 }
 
                 if(Result.Type == TokenTypeNone) {
@@ -176,19 +381,19 @@ GetToken(tokenizer* Tokenizer) {
                     // Result.Type = TokenTypeError;
 
                     Result.Identifier = StringWithLength(Tokenizer->At, TokenEndIndex);
+                    Result.Symbol = Symbol;
                     Result.Type = TokenTypeIdentifier;
                 }
                 Tokenizer->At += TokenEndIndex;
 
             } else {
-                static char ErrorMessageBuffer[] = "Unknown character '\0'";
-                Result.ErrorMessage = String(ErrorMessageBuffer);
-                Result.ErrorMessage.Contents[Result.ErrorMessage.Length - 2] = Char;
+                Result.ErrorMessage = PushFormat(Tokenizer->Arena, "Unknown character '%c'", Char);
                 Result.Type = TokenTypeError;
                 Tokenizer->At += 1;
             }
         }
 
+        Result.Text = StringWithLength(TokenStart, Tokenizer->At - TokenStart);
         Tokenizer->LastReadToken = Result;
     }
 
@@ -207,3 +412,569 @@ PeekNextToken(tokenizer* Tokenizer) {
     return Result;
 }
 
+
+// --- Expressions
+//
+// A whole line is parsed into a tree before anything runs, so a mistake
+// anywhere on the line means nothing gets rolled. Each expression is then
+// compiled into a flat program (see dice_program) that can be run many times
+// without going back to the text.
+//
+//   line       := 'quit' | 'exit' | 'dist' expression | 'sim' INT expression | item*
+//   item       := STRING | expression
+//   expression := sum [comparison sum]
+//   sum        := product (('+' | '-') product)*
+//   product    := unary (('*' | '/') unary)*
+//   unary      := ('-' | '+') unary | DICE | INT | '(' sum ')'
+//
+// ex. "2 * (2d20 + 4) - 3d8 > 7 - 3d6"
+//
+// DICE can keep only the highest or lowest dice, ex. 4d6kh3 or 2d20kl1, and
+// 'adv' and 'dis' are 2d20kh1 and 2d20kl1. They can also reroll low faces
+// (4d6r1), explode (6d6!) and count successes (10d10#>=7) (see dice_set).
+
+enum dice_node_type {
+    DiceNodeNumber,
+    DiceNodeDice,
+    DiceNodeNegate,
+    DiceNodeAdd,
+    DiceNodeSubtract,
+    DiceNodeMultiply,
+    DiceNodeDivide,
+    DiceNodeCompare,
+};
+
+struct dice_node {
+    dice_node_type Type;
+    token_type Comparison; // For DiceNodeCompare
+    s64 Number;
+    dice_set Dice;
+
+    dice_node* Left; // Also the operand of DiceNodeNegate
+    dice_node* Right;
+
+    string Text;
+};
+
+enum dice_command_type {
+    DiceCommandRoll,
+    DiceCommandQuit,
+    DiceCommandDist,
+    DiceCommandSim,
+    DiceCommandWatch,
+};
+
+enum dice_item_type {
+    DiceItemExpression,
+    DiceItemString,
+};
+
+struct dice_item {
+    dice_item_type Type;
+    dice_node* Expression;
+    string String;
+};
+
+#define MaxDiceNodes      256
+#define MaxDiceItems      32
+#define MaxDiceNesting    32
+#define MaxDiceStackDepth 32
+
+struct dice_line {
+    dice_command_type Command;
+    s64 NumSamples; // For 'sim'
+
+    dice_item Items[MaxDiceItems];
+    s32 NumItems;
+
+    dice_node Nodes[MaxDiceNodes];
+    s32 NumNodes;
+
+    symbol_table* Symbols; // Every name on the line
+
+    string ErrorMessage; // Set when the line could not be parsed
+    string ErrorText;    // The text the error was found at, if any
+};
+
+struct dice_parser {
+    tokenizer* Tokenizer;
+    dice_line* Line;
+    char* End; // Just past the last token taken
+    s32 Nesting;
+};
+
+internal b32
+IsComparison(token_type Type) {
+    b32 Result = (Type == TokenTypeGreater || Type == TokenTypeGreaterEqual ||
+                  Type == TokenTypeLess    || Type == TokenTypeLessEqual);
+    return Result;
+}
+
+internal b32
+Compare(token_type Comparison, s64 Value, s64 Target) {
+    b32 Result = false;
+    switch(Comparison) {
+        case TokenTypeGreater:      Result = Value >  Target; break;
+        case TokenTypeGreaterEqual: Result = Value >= Target; break;
+        case TokenTypeLess:         Result = Value <  Target; break;
+        case TokenTypeLessEqual:    Result = Value <= Target; break;
+        default: Unreachable;
+    }
+    return Result;
+}
+
+internal char const*
+ComparisonString(token_type Comparison) {
+    char const* Result = "";
+    switch(Comparison) {
+        case TokenTypeGreater:      Result = ">";  break;
+        case TokenTypeGreaterEqual: Result = ">="; break;
+        case TokenTypeLess:         Result = "<";  break;
+        case TokenTypeLessEqual:    Result = "<="; break;
+        default: break;
+    }
+    return Result;
+}
+
+// Only the first error on a line is kept
+internal void
+SetParseError(dice_parser* Parser, string Message, token At) {
+    dice_line* Line = Parser->Line;
+    if(Line->ErrorMessage.Length == 0) {
+        if(At.Type == TokenTypeError) {
+            Line->ErrorMessage = At.ErrorMessage;
+        } else {
+            Line->ErrorMessage = Message;
+            Line->ErrorText = At.Text;
+        }
+    }
+}
+
+internal b32
+HasParseError(dice_parser* Parser) {
+    return Parser->Line->ErrorMessage.Length > 0;
+}
+
+internal token
+TakeToken(dice_parser* Parser) {
+    token Result = GetToken(Parser->Tokenizer);
+    Parser->End = Parser->Tokenizer->At;
+    return Result;
+}
+
+internal dice_node*
+NewDiceNode(dice_parser* Parser, dice_node_type Type, token At) {
+    dice_node* Result = NULL;
+    dice_line* Line = Parser->Line;
+    if(Line->NumNodes < MaxDiceNodes) {
+        Result = &Line->Nodes[Line->NumNodes++];
+        *Result = {};
+        Result->Type = Type;
+    } else {
+        SetParseError(Parser, String("Expression is too long"), At);
+    }
+    return Result;
+}
+
+internal dice_node*
+NewBinaryNode(dice_parser* Parser, dice_node_type Type, token Operator, dice_node* Left, dice_node* Right, char* Start) {
+    dice_node* Result = NULL;
+    if(Left && Right) {
+        Result = NewDiceNode(Parser, Type, Operator);
+        if(Result) {
+            Result->Left = Left;
+            Result->Right = Right;
+            Result->Text = StringWithLength(Start, Parser->End - Start);
+        }
+    }
+    return Result;
+}
+
+internal dice_node* ParseDiceSumNode(dice_parser* Parser);
+
+internal dice_node*
+ParseDiceUnary(dice_parser* Parser) {
+    dice_node* Result = NULL;
+    token Token = TakeToken(Parser);
+    char* Start = Token.Text.Contents;
+
+    if(Token.Type == TokenTypeMinus || Token.Type == TokenTypePlus) {
+        // Every sign recurses once before any node is made, so they count
+        // against the same limit as parentheses
+        if(++Parser->Nesting > MaxDiceNesting) {
+            SetParseError(Parser, String("Too many signs in a row"), Token);
+        } else {
+            dice_node* Operand = ParseDiceUnary(Parser);
+            if(Token.Type == TokenTypePlus) {
+                Result = Operand;
+            } else if(Operand) {
+                Result = NewDiceNode(Parser, DiceNodeNegate, Token);
+                if(Result) {
+                    Result->Left = Operand;
+                }
+            }
+        }
+        --Parser->Nesting;
+    } else if(Token.Type == TokenTypeInt) {
+        Result = NewDiceNode(Parser, DiceNodeNumber, Token);
+        if(Result) {
+            Result->Number = Token.Number;
+        }
+    } else if(Token.Type == TokenTypeDice) {
+        Result = NewDiceNode(Parser, DiceNodeDice, Token);
+        if(Result) {
+            Result->Dice = Token.Dice;
+        }
+    } else if(Token.Type == TokenTypeOpenParen) {
+        if(++Parser->Nesting > MaxDiceNesting) {
+            SetParseError(Parser, String("Too many nested parentheses"), Token);
+        } else {
+            Result = ParseDiceSumNode(Parser);
+            token Close = TakeToken(Parser);
+            if(Result && Close.Type != TokenTypeCloseParen) {
+                SetParseError(Parser, String("Expected ')'"), Close);
+                Result = NULL;
+            }
+        }
+        --Parser->Nesting;
+    } else {
+        SetParseError(Parser, String("Expected dice, a number or '('"), Token);
+    }
+
+    if(Result && Result->Text.Length == 0) {
+        Result->Text = StringWithLength(Start, Parser->End - Start);
+    }
+    return Result;
+}
+
+internal dice_node*
+ParseDiceProduct(dice_parser* Parser) {
+    char* Start = PeekNextToken(Parser->Tokenizer).Text.Contents;
+    dice_node* Result = ParseDiceUnary(Parser);
+
+    for(;;) {
+        token Operator = PeekNextToken(Parser->Tokenizer);
+        if(!Result || (Operator.Type != TokenTypeStar && Operator.Type != TokenTypeSlash)) {
+            break;
+        }
+
+        TakeToken(Parser);
+        dice_node* Right = ParseDiceUnary(Parser);
+        Result = NewBinaryNode(Parser, Operator.Type == TokenTypeStar ? DiceNodeMultiply : DiceNodeDivide,
+                               Operator, Result, Right, Start);
+    }
+
+    return Result;
+}
+
+internal dice_node*
+ParseDiceSumNode(dice_parser* Parser) {
+    char* Start = PeekNextToken(Parser->Tokenizer).Text.Contents;
+    dice_node* Result = ParseDiceProduct(Parser);
+
+    for(;;) {
+        token Operator = PeekNextToken(Parser->Tokenizer);
+        if(!Result || (Operator.Type != TokenTypePlus && Operator.Type != TokenTypeMinus)) {
+            break;
+        }
+
+        TakeToken(Parser);
+        dice_node* Right = ParseDiceProduct(Parser);
+        Result = NewBinaryNode(Parser, Operator.Type == TokenTypePlus ? DiceNodeAdd : DiceNodeSubtract,
+                               Operator, Result, Right, Start);
+    }
+
+    return Result;
+}
+
+// Stack slots needed to run the compiled node
+internal s32
+DiceStackDepth(dice_node* Node) {
+    s32 Result = 1;
+    if(Node->Type == DiceNodeNegate) {
+        Result = DiceStackDepth(Node->Left);
+    } else if(Node->Left) {
+        s32 Left = DiceStackDepth(Node->Left);
+        s32 Right = DiceStackDepth(Node->Right) + 1;
+        Result = Left > Right ? Left : Right;
+    }
+    return Result;
+}
+
+internal dice_node*
+ParseDiceExpression(dice_parser* Parser) {
+    char* Start = PeekNextToken(Parser->Tokenizer).Text.Contents;
+    dice_node* Result = ParseDiceSumNode(Parser);
+
+    token Operator = PeekNextToken(Parser->Tokenizer);
+    if(Result && IsComparison(Operator.Type)) {
+        TakeToken(Parser);
+        dice_node* Right = ParseDiceSumNode(Parser);
+        Result = NewBinaryNode(Parser, DiceNodeCompare, Operator, Result, Right, Start);
+        if(Result) {
+            Result->Comparison = Operator.Type;
+
+            token Next = PeekNextToken(Parser->Tokenizer);
+            if(IsComparison(Next.Type)) {
+                SetParseError(Parser, String("Only one comparison is allowed"), Next);
+            }
+        }
+    }
+
+    if(Result && DiceStackDepth(Result) > MaxDiceStackDepth) {
+        SetParseError(Parser, String("Expression is too deeply nested"), Operator);
+    }
+
+    return HasParseError(Parser) ? NULL : Result;
+}
+
+internal void
+AddDiceItem(dice_parser* Parser, dice_item Item, token At) {
+    dice_line* Line = Parser->Line;
+    if(Line->NumItems < MaxDiceItems) {
+        Line->Items[Line->NumItems++] = Item;
+    } else {
+        SetParseError(Parser, String("Too many rolls on one line"), At);
+    }
+}
+
+// Everything the line points to lives in the command or in Arena
+internal void
+ParseDiceLine(string Command, dice_line* Line, memory_arena* Arena) {
+    *Line = {};
+
+    tokenizer Tokenizer = {};
+    Tokenizer.At = Command.Contents;
+    Tokenizer.End = Command.Contents + Command.Length;
+    Tokenizer.Arena = Arena;
+    Tokenizer.Symbols = NewSymbolTable(Arena);
+    Line->Symbols = Tokenizer.Symbols;
+
+    dice_parser Parser = {};
+    Parser.Tokenizer = &Tokenizer;
+    Parser.Line = Line;
+
+    token First = PeekNextToken(&Tokenizer);
+    if(First.Type == TokenTypeIdentifier) {
+        TakeToken(&Parser);
+
+        dice_item Item = {};
+        Item.Type = DiceItemExpression;
+
+        switch(First.Symbol) {
+            case KeywordQuit:
+            case KeywordExit: {
+                Line->Command = DiceCommandQuit;
+            } break;
+
+            case KeywordDist: {
+                Line->Command = DiceCommandDist;
+                Item.Expression = ParseDiceExpression(&Parser);
+                AddDiceItem(&Parser, Item, First);
+            } break;
+
+            case KeywordWatch: {
+                Line->Command = DiceCommandWatch;
+                Item.Expression = ParseDiceExpression(&Parser);
+                AddDiceItem(&Parser, Item, First);
+            } break;
+
+            case KeywordSim: {
+                Line->Command = DiceCommandSim;
+                token CountToken = TakeToken(&Parser);
+                if(CountToken.Type == TokenTypeInt && CountToken.Number > 0) {
+                    Line->NumSamples = CountToken.Number;
+                    Item.Expression = ParseDiceExpression(&Parser);
+                    AddDiceItem(&Parser, Item, First);
+                } else {
+                    SetParseError(&Parser, String("Expected the number of samples after 'sim'"), CountToken);
+                }
+            } break;
+
+            default: {
+                // The name is already in the message, so the error isn't put at a token
+                string Name = SymbolName(Line->Symbols, First.Symbol);
+                char const* Format = (First.Symbol < KeywordCount) ? "'%.*s' is reserved for a future command" : "Unknown command '%.*s'";
+                token NoToken = {};
+                SetParseError(&Parser, PushFormat(Arena, Format, StringAsArgs(Name)), NoToken);
+            } break;
+        }
+
+        token Next = TakeToken(&Parser);
+        if(Next.Type != TokenTypeEndOfStream) {
+            SetParseError(&Parser, String("Unexpected input"), Next);
+        }
+    } else {
+        Line->Command = DiceCommandRoll;
+
+        while(!HasParseError(&Parser)) {
+            token Next = PeekNextToken(&Tokenizer);
+            if(Next.Type == TokenTypeEndOfStream) {
+                break;
+            }
+
+            dice_item Item = {};
+            if(Next.Type == TokenTypeString) {
+                TakeToken(&Parser);
+                Item.Type = DiceItemString;
+                Item.String = Next.String;
+            } else if(Next.Type == TokenTypeIdentifier) {
+                SetParseError(&Parser, String("Commands must start the line"), Next);
+                break;
+            } else {
+                Item.Type = DiceItemExpression;
+                Item.Expression = ParseDiceExpression(&Parser);
+            }
+            AddDiceItem(&Parser, Item, Next);
+        }
+    }
+}
+
+// --- Programs
+//
+// Expressions compiled to a flat list of instructions for a stack machine, so
+// running them again (ex. millions of times in 'sim') skips all of the parsing
+// and pointer chasing. Numbers are folded together at compile time. Run with
+// RunDiceProgram (dice-roll.cpp).
+
+enum dice_opcode {
+    DiceOpPush,     // Push Value
+    DiceOpRoll,     // Push the total of Dice, or the number of successes when they are counted
+    DiceOpNegate,
+    DiceOpAdd,
+    DiceOpSubtract,
+    DiceOpMultiply,
+    DiceOpDivide,   // Rounds towards zero
+};
+
+struct dice_instruction {
+    dice_opcode Opcode;
+    s64 Value;
+    dice_set Dice; // For DiceOpRoll
+};
+
+struct dice_program {
+    // Can't be longer than the tree it comes from
+    dice_instruction Instructions[MaxDiceNodes];
+    s32 NumInstructions;
+
+    // When set the program leaves both sides of the comparison on the stack
+    token_type Comparison;
+
+    string Text;
+    string LeftText;  // Text of the side being compared, or all of Text
+    string RightText; // Text of what it is compared to
+};
+
+internal dice_instruction*
+EmitDiceInstruction(dice_program* Program, dice_opcode Opcode, s64 Value = 0) {
+    dice_instruction* Instruction = &Program->Instructions[Program->NumInstructions++];
+    ClearBytes(Instruction, sizeof(*Instruction));
+    Instruction->Opcode = Opcode;
+    Instruction->Value = Value;
+    return Instruction;
+}
+
+// Returns true if the node is a number known at compile time, which is then in Value.
+// Anything that would overflow isn't folded, and is left for DiceProgramRange to reject.
+internal b32
+FoldDiceConstant(dice_node* Node, s64* Value) {
+    b32 Result = false;
+    s64 Left = 0, Right = 0;
+
+    switch(Node->Type) {
+        case DiceNodeNumber: {
+            *Value = Node->Number;
+            Result = true;
+        } break;
+
+        case DiceNodeNegate: {
+            if(FoldDiceConstant(Node->Left, &Left)) {
+                Result = !__builtin_sub_overflow((s64)0, Left, Value);
+            }
+        } break;
+
+        case DiceNodeAdd:
+        case DiceNodeSubtract:
+        case DiceNodeMultiply:
+        case DiceNodeDivide: {
+            if(FoldDiceConstant(Node->Left, &Left) && FoldDiceConstant(Node->Right, &Right)) {
+                Result = true;
+                switch(Node->Type) {
+                    case DiceNodeAdd:      Result = !__builtin_add_overflow(Left, Right, Value); break;
+                    case DiceNodeSubtract: Result = !__builtin_sub_overflow(Left, Right, Value); break;
+                    case DiceNodeMultiply: Result = !__builtin_mul_overflow(Left, Right, Value); break;
+                    default: {
+                        // Division by zero is left for RunDiceProgram to report
+                        Result = (Right != 0 && !(Left == INT64_MIN && Right == -1));
+                        if(Result) {
+                            *Value = Left / Right;
+                        }
+                    } break;
+                }
+            }
+        } break;
+
+        default: break;
+    }
+
+    return Result;
+}
+
+internal void
+CompileDiceNode(dice_program* Program, dice_node* Node) {
+    s64 Constant = 0;
+    if(FoldDiceConstant(Node, &Constant)) {
+        EmitDiceInstruction(Program, DiceOpPush, Constant);
+    } else {
+        switch(Node->Type) {
+            case DiceNodeDice: {
+                dice_instruction* Roll = EmitDiceInstruction(Program, DiceOpRoll);
+                Roll->Dice = Node->Dice;
+            } break;
+
+            case DiceNodeNegate: {
+                CompileDiceNode(Program, Node->Left);
+                EmitDiceInstruction(Program, DiceOpNegate);
+            } break;
+
+            case DiceNodeAdd:
+            case DiceNodeSubtract:
+            case DiceNodeMultiply:
+            case DiceNodeDivide: {
+                CompileDiceNode(Program, Node->Left);
+                CompileDiceNode(Program, Node->Right);
+
+                dice_opcode Opcode = DiceOpAdd;
+                switch(Node->Type) {
+                    case DiceNodeSubtract: Opcode = DiceOpSubtract; break;
+                    case DiceNodeMultiply: Opcode = DiceOpMultiply; break;
+                    case DiceNodeDivide:   Opcode = DiceOpDivide;   break;
+                    default: break;
+                }
+                EmitDiceInstruction(Program, Opcode);
+            } break;
+
+            default: Unreachable;
+        }
+    }
+}
+
+internal void
+CompileDiceProgram(dice_node* Root, dice_program* Program) {
+    Program->NumInstructions = 0;
+    Program->Comparison = TokenTypeNone;
+    Program->Text = Root->Text;
+    Program->LeftText = Root->Text;
+    Program->RightText = {};
+
+    if(Root->Type == DiceNodeCompare) {
+        Program->Comparison = Root->Comparison;
+        Program->LeftText = Root->Left->Text;
+        Program->RightText = Root->Right->Text;
+        CompileDiceNode(Program, Root->Left);
+        CompileDiceNode(Program, Root->Right);
+    } else {
+        CompileDiceNode(Program, Root);
+    }
+}
@@ -0,0 +1,684 @@
+/*
+  File: dice-dist.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Exact probability distributions of sums of dice.
+
+// Probabilities[Index] is the chance of getting MinValue + Index
+struct distribution {
+    s64 MinValue;
+    array<r64> Probabilities;
+};
+
+// Distributions longer than this are refused (128MB of probabilities)
+#define MaxDistributionLength (1 << 24)
+
+// The longest distribution 'dist' computes. The server lowers it, since it
+// answers everyone on one thread.
+global s64 DistMaxLength = MaxDistributionLength;
+
+// Below this many entries on the short side, direct convolution beats the FFT
+#define DirectConvolutionLimit 64
+
+internal distribution
+AllocateDistribution(s64 MinValue, int_size Length) {
+    distribution Result = {};
+    Result.MinValue = MinValue;
+    Result.Probabilities = AllocateArray<r64>(Length);
+    ClearBytes(Result.Probabilities.Contents, Length * sizeof(r64));
+    return Result;
+}
+
+internal void
+DeallocateDistribution(distribution* Distribution) {
+    DeallocateArray(&Distribution->Probabilities);
+    Distribution->MinValue = 0;
+}
+
+// Iterative radix-2 FFT. Length must be a power of 2. Inverse does not scale.
+internal void
+FFT(r64* Real, r64* Imag, int_size Length, b32 Inverse) {
+    for(int_size Index = 1, Reversed = 0; Index < Length; ++Index) {
+        int_size Bit = Length >> 1;
+        for(; Reversed & Bit; Bit >>= 1) {
+            Reversed ^= Bit;
+        }
+        Reversed ^= Bit;
+
+        if(Index < Reversed) {
+            r64 Temp = Real[Index]; Real[Index] = Real[Reversed]; Real[Reversed] = Temp;
+            Temp = Imag[Index]; Imag[Index] = Imag[Reversed]; Imag[Reversed] = Temp;
+        }
+    }
+
+    for(int_size Size = 2; Size <= Length; Size <<= 1) {
+        r64 Angle = (Inverse ? 2 : -2) * 3.14159265358979323846 / (r64)Size;
+        r64 StepReal = cos(Angle);
+        r64 StepImag = sin(Angle);
+
+        for(int_size Start = 0; Start < Length; Start += Size) {
+            r64 TwiddleReal = 1;
+            r64 TwiddleImag = 0;
+
+            for(int_size Index = 0; Index < Size / 2; ++Index) {
+                int_size Even = Start + Index;
+                int_size Odd  = Even + Size / 2;
+
+                r64 OddReal = Real[Odd] * TwiddleReal - Imag[Odd] * TwiddleImag;
+                r64 OddImag = Real[Odd] * TwiddleImag + Imag[Odd] * TwiddleReal;
+
+                Real[Odd] = Real[Even] - OddReal;
+                Imag[Odd] = Imag[Even] - OddImag;
+                Real[Even] += OddReal;
+                Imag[Even] += OddImag;
+
+                r64 NextReal = TwiddleReal * StepReal - TwiddleImag * StepImag;
+                TwiddleImag  = TwiddleReal * StepImag + TwiddleImag * StepReal;
+                TwiddleReal  = NextReal;
+            }
+        }
+    }
+}
+
+internal void
+CopyInto(array<r64> Array, r64* Buffer) {
+    for(int_size Index = 0; Index < Array.Length; ++Index) {
+        Buffer[Index] = Array.Contents[Index];
+    }
+}
+
+internal distribution
+CopyDistribution(distribution Distribution) {
+    distribution Result = AllocateDistribution(Distribution.MinValue, Distribution.Probabilities.Length);
+    CopyInto(Distribution.Probabilities, Result.Probabilities.Contents);
+    return Result;
+}
+
+// Distribution of A + B
+internal distribution
+ConvolveDistributions(distribution A, distribution B) {
+    int_size LengthA = A.Probabilities.Length;
+    int_size LengthB = B.Probabilities.Length;
+    distribution Result = AllocateDistribution(A.MinValue + B.MinValue, LengthA + LengthB - 1);
+
+    if(LengthA <= DirectConvolutionLimit || LengthB <= DirectConvolutionLimit) {
+        for(int_size IndexA = 0; IndexA < LengthA; ++IndexA) {
+            r64 ProbabilityA = A.Probabilities.Contents[IndexA];
+            r64* Out = Result.Probabilities.Contents + IndexA;
+            for(int_size IndexB = 0; IndexB < LengthB; ++IndexB) {
+                Out[IndexB] += ProbabilityA * B.Probabilities.Contents[IndexB];
+            }
+        }
+    } else {
+        int_size FFTLength = 1;
+        while(FFTLength < Result.Probabilities.Length) {
+            FFTLength <<= 1;
+        }
+
+        // A goes in the real part and B in the imaginary part so one forward
+        // transform does both.
+        array<r64> Real = AllocateArray<r64>(FFTLength);
+        array<r64> Imag = AllocateArray<r64>(FFTLength);
+        ClearBytes(Real.Contents, FFTLength * sizeof(r64));
+        ClearBytes(Imag.Contents, FFTLength * sizeof(r64));
+        CopyInto(A.Probabilities, Real.Contents);
+        CopyInto(B.Probabilities, Imag.Contents);
+
+        FFT(Real.Contents, Imag.Contents, FFTLength, false);
+
+        // With Z = FFT(A + iB): FFT(A)[k] * FFT(B)[k] = (Z[k]^2 - conj(Z[-k])^2) / 4i
+        array<r64> ProductReal = AllocateArray<r64>(FFTLength);
+        array<r64> ProductImag = AllocateArray<r64>(FFTLength);
+        for(int_size Index = 0; Index < FFTLength; ++Index) {
+            int_size Mirror = (FFTLength - Index) & (FFTLength - 1);
+            r64 ZReal = Real.Contents[Index],  ZImag = Imag.Contents[Index];
+            r64 MReal = Real.Contents[Mirror], MImag = -Imag.Contents[Mirror];
+
+            r64 DiffReal = (ZReal * ZReal - ZImag * ZImag) - (MReal * MReal - MImag * MImag);
+            r64 DiffImag = 2 * ZReal * ZImag - 2 * MReal * MImag;
+
+            // Divide by 4i
+            ProductReal.Contents[Index] =  DiffImag / 4;
+            ProductImag.Contents[Index] = -DiffReal / 4;
+        }
+
+        FFT(ProductReal.Contents, ProductImag.Contents, FFTLength, true);
+
+        for(int_size Index = 0; Index < Result.Probabilities.Length; ++Index) {
+            r64 Probability = ProductReal.Contents[Index] / (r64)FFTLength;
+            // Rounding error can go slightly negative where the true value is ~0
+            Result.Probabilities.Contents[Index] = Probability < 0 ? 0 : Probability;
+        }
+
+        Deallocate(Real);
+        Deallocate(Imag);
+        Deallocate(ProductReal);
+        Deallocate(ProductImag);
+    }
+
+    return Result;
+}
+
+// Distribution of -A
+internal distribution
+NegateDistribution(distribution A) {
+    int_size Length = A.Probabilities.Length;
+    distribution Result = AllocateDistribution(-(A.MinValue + Length - 1), Length);
+    for(int_size Index = 0; Index < Length; ++Index) {
+        Result.Probabilities.Contents[Index] = A.Probabilities.Contents[Length - 1 - Index];
+    }
+    return Result;
+}
+
+// Sum of Count independent copies of Die, built by squaring
+internal distribution
+PowerDistribution(distribution Die, s32 Count) {
+    distribution Result = AllocateDistribution(0, 1);
+    Result.Probabilities.Contents[0] = 1;
+
+    distribution Power = CopyDistribution(Die);
+    for(s32 Remaining = Count; Remaining > 0; Remaining >>= 1) {
+        if(Remaining & 1) {
+            distribution Next = ConvolveDistributions(Result, Power);
+            DeallocateDistribution(&Result);
+            Result = Next;
+        }
+
+        if(Remaining > 1) {
+            distribution Next = ConvolveDistributions(Power, Power);
+            DeallocateDistribution(&Power);
+            Power = Next;
+        }
+    }
+
+    DeallocateDistribution(&Power);
+    return Result;
+}
+
+// Values one die can add up to without keeping: its faces, every face it can
+// add up to by exploding, or how many times it can succeed
+internal s64
+DieDistributionLength(dice_set Dice) {
+    s64 NumRolls = Dice.Explodes ? MaxExplosions + 1 : 1;
+    s64 Result = (Dice.SuccessComparison != TokenTypeNone) ? NumRolls + 1 : NumRolls * Dice.NumSides + 1;
+    return Result;
+}
+
+// One die of Dice (which isn't kept from). Rerolled faces are left out, and a
+// die that explodes adds up a run of highest faces and then the face that ended
+// the run. Every run of the same length adds up the same, so the chance of
+// each value is the chance of the run times the chance of the face after it.
+internal distribution
+ComputeDieDistribution(dice_set Dice) {
+    s32 Offset = Dice.RerollBelow;
+    s32 NumFaces = Dice.NumSides - Offset;
+    s32 SuccessLow, SuccessHigh;
+    GetSuccessFaces(Dice, &SuccessLow, &SuccessHigh);
+    b32 CountsSuccesses = (Dice.SuccessComparison != TokenTypeNone);
+
+    distribution Result = AllocateDistribution(0, DieDistributionLength(Dice));
+    r64* Probabilities = Result.Probabilities.Contents;
+    r64 FaceProbability = 1.0 / (r64)NumFaces;
+
+    s32 MaxRun = Dice.Explodes ? MaxExplosions : 0;
+    s64 HighestValue = CountsSuccesses ? (Dice.NumSides >= SuccessLow && Dice.NumSides <= SuccessHigh) : Dice.NumSides;
+    r64 RunProbability = 1;
+    for(s32 Run = 0; Run <= MaxRun && RunProbability > 0; ++Run) {
+        for(s32 Face = Offset + 1; Face <= Dice.NumSides; ++Face) {
+            if(Face == Dice.NumSides && Run < MaxRun) {
+                // Goes on to a longer run
+                continue;
+            }
+
+            s64 Value = CountsSuccesses ? (Face >= SuccessLow && Face <= SuccessHigh) : Face;
+            Probabilities[Run * HighestValue + Value] += RunProbability * FaceProbability;
+        }
+        RunProbability *= FaceProbability;
+    }
+
+    // Trim the values that can't come up (ex. below the lowest face)
+    int_size First = 0;
+    while(Probabilities[First] == 0) {
+        ++First;
+    }
+    int_size Last = Result.Probabilities.Length - 1;
+    while(Probabilities[Last] == 0) {
+        --Last;
+    }
+
+    distribution Trimmed = AllocateDistribution(First, Last - First + 1);
+    for(int_size Index = First; Index <= Last; ++Index) {
+        Trimmed.Probabilities.Contents[Index - First] = Probabilities[Index];
+    }
+    DeallocateDistribution(&Result);
+    return Trimmed;
+}
+
+// Count dice of Dice (which isn't kept from)
+internal distribution
+ComputeDiceDistribution(dice_set Dice) {
+    distribution Die = ComputeDieDistribution(Dice);
+    distribution Result = PowerDistribution(Die, Dice.Count);
+    DeallocateDistribution(&Die);
+    return Result;
+}
+
+// Kept dice with more work than this (faces * states * dice kept) are refused
+#define MaxKeptDistributionWork (1LL << 31)
+
+// Lowered by the server along with DistMaxLength
+global s64 DistMaxKeptWork = MaxKeptDistributionWork;
+
+internal b32
+CanComputeKeptDistribution(s32 NumSides, s32 NumKept) {
+    r64 NumStates = (r64)NumKept * ((r64)NumKept * NumSides + 1);
+    r64 Work = (r64)NumSides * NumSides * NumKept * NumKept * NumKept / 6;
+    b32 Result = (NumStates <= DistMaxLength && Work <= DistMaxKeptWork);
+    return Result;
+}
+
+// Distribution of the NumKept highest (or lowest) of Count dice. Faces are
+// gone through from the highest down. Before face F every die not placed yet
+// shows F or lower, so each one is F with chance 1/F and how many are F is
+// binomial. The state is how many dice are kept so far and their total. Once
+// NumKept dice are placed the rest can't change the total, so the state is
+// finished, which keeps the work independent of Count. Keeping the lowest is
+// the same with the faces mirrored.
+internal distribution
+ComputeKeptDiceDistribution(s32 Count, s32 NumSides, s32 NumKept, b32 KeepLowest) {
+    s64 RowLength = (s64)NumKept * NumSides + 1; // Totals from 0 to the largest
+    s64 NumStates = NumKept * RowLength;
+
+    // Open[Kept * RowLength + Total]
+    r64* Open = AllocateOnHeapTyped<r64>(NumStates);
+    r64* Next = AllocateOnHeapTyped<r64>(NumStates);
+    r64* Binomial = AllocateOnHeapTyped<r64>(NumKept);
+    ClearBytes(Open, sizeof(r64) * NumStates);
+    Open[0] = 1;
+
+    distribution Finished = AllocateDistribution(0, RowLength);
+    r64* FinishedTotals = Finished.Probabilities.Contents;
+
+    for(s32 Face = NumSides; Face >= 1; --Face) {
+        ClearBytes(Next, sizeof(r64) * NumStates);
+        r64 LogP = log(1.0 / Face);
+        r64 LogQ = log1p(-1.0 / Face);
+
+        for(s32 Kept = 0; Kept < NumKept; ++Kept) {
+            s64 Left = (s64)Count - Kept;
+            s32 Needed = NumKept - Kept;
+
+            // Chance of c of the dice left showing Face, for fewer than are
+            // needed, and of at least as many as are needed
+            r64 Below = 0;
+            for(s32 Shown = 0; Shown < Needed; ++Shown) {
+                Binomial[Shown] = 0;
+                if(Face > 1) {
+                    Binomial[Shown] = exp(lgamma((r64)Left + 1) - lgamma((r64)Shown + 1) - lgamma((r64)(Left - Shown) + 1) +
+                                          Shown * LogP + (Left - Shown) * LogQ);
+                }
+                Below += Binomial[Shown];
+            }
+            r64 AtLeastNeeded = Below < 1 ? 1 - Below : 0;
+
+            r64* Row = Open + Kept * RowLength;
+            for(s64 Total = 0; Total <= (s64)Kept * NumSides; ++Total) {
+                r64 Chance = Row[Total];
+                if(Chance != 0) {
+                    for(s32 Shown = 0; Shown < Needed; ++Shown) {
+                        Next[(Kept + Shown) * RowLength + Total + (s64)Shown * Face] += Chance * Binomial[Shown];
+                    }
+                    FinishedTotals[Total + (s64)Needed * Face] += Chance * AtLeastNeeded;
+                }
+            }
+        }
+
+        r64* Swap = Open;
+        Open = Next;
+        Next = Swap;
+    }
+
+    // Every total is at least NumKept
+    distribution Result = AllocateDistribution(NumKept, RowLength - NumKept);
+    for(int_size Index = 0; Index < Result.Probabilities.Length; ++Index) {
+        int_size From = KeepLowest ? Finished.Probabilities.Length - 1 - Index : NumKept + Index;
+        Result.Probabilities.Contents[Index] = FinishedTotals[From];
+    }
+
+    DeallocateDistribution(&Finished);
+    DeallocateHeap(Binomial);
+    DeallocateHeap(Next);
+    DeallocateHeap(Open);
+    return Result;
+}
+
+// --- Cache
+//
+// Recently used distributions of single dice terms, so asking about the same
+// dice again does not recompute them. A single distribution can be 128MB, so
+// the cache is also kept under a number of bytes by dropping the least
+// recently used ones. The one just asked for always stays.
+
+#define DistributionCacheSize 32
+#define DistributionCacheMaxBytes Megabytes(64)
+
+struct distribution_cache_entry {
+    dice_set Dice;
+    u64 LastUsed; // 0 if the entry is empty
+    distribution Distribution;
+};
+
+struct distribution_cache {
+    distribution_cache_entry Entries[DistributionCacheSize];
+    u64 UseCounter;
+    s64 NumBytes; // Probabilities held by all the entries
+};
+
+global distribution_cache DistributionCache;
+
+// The returned distribution belongs to the cache and is valid until the next call
+internal distribution
+DiceDistribution(dice_set Dice) {
+    if(Dice.NumKept == Dice.Count) {
+        // Keeping every die is the same as not choosing
+        Dice.NumKept = 0;
+    }
+    if(Dice.NumKept == 0) {
+        Dice.KeepLowest = false;
+    }
+
+    distribution_cache* Cache = &DistributionCache;
+    distribution_cache_entry* Found = NULL;
+    distribution_cache_entry* LeastRecentlyUsed = &Cache->Entries[0];
+
+    for(s32 Index = 0; Index < DistributionCacheSize; ++Index) {
+        distribution_cache_entry* Entry = &Cache->Entries[Index];
+        if(Entry->LastUsed != 0 && DiceSetsEqual(Entry->Dice, Dice)) {
+            Found = Entry;
+            break;
+        }
+
+        if(Entry->LastUsed < LeastRecentlyUsed->LastUsed) {
+            LeastRecentlyUsed = Entry;
+        }
+    }
+
+    if(!Found) {
+        Found = LeastRecentlyUsed;
+        Cache->NumBytes -= Found->Distribution.Probabilities.Length * (s64)sizeof(r64);
+        DeallocateDistribution(&Found->Distribution);
+
+        Found->Dice = Dice;
+        if(Dice.NumKept > 0) {
+            // Keeping from dice that reroll is keeping from dice with fewer
+            // faces, and every kept die is RerollBelow higher
+            Found->Distribution = ComputeKeptDiceDistribution(Dice.Count, Dice.NumSides - Dice.RerollBelow,
+                                                              Dice.NumKept, Dice.KeepLowest);
+            Found->Distribution.MinValue += (s64)Dice.NumKept * Dice.RerollBelow;
+        } else {
+            Found->Distribution = ComputeDiceDistribution(Dice);
+        }
+        Cache->NumBytes += Found->Distribution.Probabilities.Length * (s64)sizeof(r64);
+    }
+
+    Found->LastUsed = ++Cache->UseCounter;
+
+    while(Cache->NumBytes > DistributionCacheMaxBytes) {
+        distribution_cache_entry* Oldest = NULL;
+        for(s32 Index = 0; Index < DistributionCacheSize; ++Index) {
+            distribution_cache_entry* Entry = &Cache->Entries[Index];
+            if(Entry != Found && Entry->LastUsed != 0 && (!Oldest || Entry->LastUsed < Oldest->LastUsed)) {
+                Oldest = Entry;
+            }
+        }
+        if(!Oldest) {
+            break;
+        }
+
+        Cache->NumBytes -= Oldest->Distribution.Probabilities.Length * (s64)sizeof(r64);
+        DeallocateDistribution(&Oldest->Distribution);
+        Oldest->LastUsed = 0;
+    }
+
+    return Found->Distribution;
+}
+
+// --- Statistics
+
+internal r64
+DistributionMean(distribution Distribution) {
+    r64 Result = 0;
+    for(int_size Index = 0; Index < Distribution.Probabilities.Length; ++Index) {
+        Result += Distribution.Probabilities.Contents[Index] * (r64)Index;
+    }
+    return Result + (r64)Distribution.MinValue;
+}
+
+internal r64
+DistributionVariance(distribution Distribution) {
+    r64 Mean = DistributionMean(Distribution) - (r64)Distribution.MinValue;
+    r64 Result = 0;
+    for(int_size Index = 0; Index < Distribution.Probabilities.Length; ++Index) {
+        r64 Difference = (r64)Index - Mean;
+        Result += Distribution.Probabilities.Contents[Index] * Difference * Difference;
+    }
+    return Result;
+}
+
+// Smallest value with P(total <= value) >= Fraction
+internal s64
+DistributionPercentile(distribution Distribution, r64 Fraction) {
+    r64 Cumulative = 0;
+    int_size Index = 0;
+    for(; Index < Distribution.Probabilities.Length - 1; ++Index) {
+        Cumulative += Distribution.Probabilities.Contents[Index];
+        if(Cumulative >= Fraction) {
+            break;
+        }
+    }
+    return Distribution.MinValue + Index;
+}
+
+// P(total >= Value)
+internal r64
+ProbabilityAtLeast(distribution Distribution, s64 Value) {
+    r64 Result = 0;
+    s64 MaxValue = Distribution.MinValue + Distribution.Probabilities.Length - 1;
+
+    // Compared before taking the difference, which may not fit in an int_size
+    // (or an s64) when Value is far outside the distribution
+    int_size Start = 0;
+    if(Value > MaxValue) {
+        Start = Distribution.Probabilities.Length;
+    } else if(Value > Distribution.MinValue) {
+        Start = (int_size)(Value - Distribution.MinValue);
+    }
+
+    for(int_size Index = Start; Index < Distribution.Probabilities.Length; ++Index) {
+        Result += Distribution.Probabilities.Contents[Index];
+    }
+    return Result > 1 ? 1 : Result;
+}
+
+// --- Programs
+//
+// A dice_program (dice-cmd.cpp) run over distributions instead of numbers
+
+// At most this many pairs of values are tried when multiplying or dividing two distributions
+#define MaxPairwiseCombinations (1 << 26)
+
+// Distribution of A * B or A / B, trying every pair of values
+internal b32
+CombineDistributionsPairwise(distribution A, distribution B, b32 Divide, distribution* Result, string* ErrorMessage) {
+    int_size LengthA = A.Probabilities.Length;
+    int_size LengthB = B.Probabilities.Length;
+    if((s64)LengthA * LengthB > MaxPairwiseCombinations) {
+        *ErrorMessage = String("Too many possible totals to compute");
+        return false;
+    }
+
+    s64 Min = INT64_MAX;
+    s64 Max = INT64_MIN;
+    for(int_size IndexA = 0; IndexA < LengthA; ++IndexA) {
+        for(int_size IndexB = 0; IndexB < LengthB; ++IndexB) {
+            if(A.Probabilities.Contents[IndexA] > 0 && B.Probabilities.Contents[IndexB] > 0) {
+                s64 ValueA = A.MinValue + IndexA;
+                s64 ValueB = B.MinValue + IndexB;
+                if(Divide && ValueB == 0) {
+                    *ErrorMessage = String("Could divide by zero");
+                    return false;
+                }
+
+                s64 Value = Divide ? ValueA / ValueB : ValueA * ValueB;
+                Min = Value < Min ? Value : Min;
+                Max = Value > Max ? Value : Max;
+            }
+        }
+    }
+
+    // In u64, since Max - Min can be more than an s64 holds
+    if((u64)Max - (u64)Min >= (u64)DistMaxLength) {
+        *ErrorMessage = String("Too many possible totals to compute");
+        return false;
+    }
+
+    *Result = AllocateDistribution(Min, (int_size)(Max - Min + 1));
+    for(int_size IndexA = 0; IndexA < LengthA; ++IndexA) {
+        r64 ProbabilityA = A.Probabilities.Contents[IndexA];
+        for(int_size IndexB = 0; IndexB < LengthB; ++IndexB) {
+            r64 Probability = ProbabilityA * B.Probabilities.Contents[IndexB];
+            if(Probability > 0) {
+                s64 ValueA = A.MinValue + IndexA;
+                s64 ValueB = B.MinValue + IndexB;
+                s64 Value = Divide ? ValueA / ValueB : ValueA * ValueB;
+                Result->Probabilities.Contents[Value - Min] += Probability;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Distributions of the program's total and, if it has a comparison, of what
+// the total is compared to. Returns false with ErrorMessage set if they can't
+// be computed.
+internal b32
+DiceProgramDistribution(dice_program* Program, distribution* Total, distribution* Target, string* ErrorMessage) {
+    distribution Stack[MaxDiceStackDepth] = {};
+    s32 Top = -1;
+
+    // The totals themselves have to fit before their probabilities can be worked out
+    s64 MinTotal = 0, MaxTotal = 0;
+    b32 Result = DiceProgramRange(Program, &MinTotal, &MaxTotal);
+    if(!Result) {
+        *ErrorMessage = String("Totals could be too large to compute");
+    }
+
+    for(s32 Index = 0; Index < Program->NumInstructions && Result; ++Index) {
+        dice_instruction* Instruction = &Program->Instructions[Index];
+        switch(Instruction->Opcode) {
+            case DiceOpPush: {
+                ++Top;
+                Stack[Top] = AllocateDistribution(Instruction->Value, 1);
+                Stack[Top].Probabilities.Contents[0] = 1;
+            } break;
+
+            case DiceOpRoll: {
+                dice_set Dice = Instruction->Dice;
+                b32 KeepsAll = (Dice.NumKept == 0 || Dice.NumKept == Dice.Count);
+                if(KeepsAll && DieDistributionLength(Dice) > DistMaxLength / Dice.Count) {
+                    *ErrorMessage = String("Too many possible totals to compute");
+                    Result = false;
+                } else if(!KeepsAll && !CanComputeKeptDistribution(Dice.NumSides - Dice.RerollBelow, Dice.NumKept)) {
+                    *ErrorMessage = String("Too many dice kept to compute");
+                    Result = false;
+                } else {
+                    // The cache owns what it returns, so this needs its own copy
+                    ++Top;
+                    Stack[Top] = CopyDistribution(DiceDistribution(Dice));
+                }
+            } break;
+
+            case DiceOpNegate: {
+                distribution Negated = NegateDistribution(Stack[Top]);
+                DeallocateDistribution(&Stack[Top]);
+                Stack[Top] = Negated;
+            } break;
+
+            case DiceOpAdd:
+            case DiceOpSubtract: {
+                distribution* Left = &Stack[Top - 1];
+                distribution* Right = &Stack[Top];
+                if(Left->Probabilities.Length + Right->Probabilities.Length - 1 > DistMaxLength) {
+                    *ErrorMessage = String("Too many possible totals to compute");
+                    Result = false;
+                } else {
+                    if(Instruction->Opcode == DiceOpSubtract) {
+                        distribution Negated = NegateDistribution(*Right);
+                        DeallocateDistribution(Right);
+                        *Right = Negated;
+                    }
+
+                    distribution Sum = ConvolveDistributions(*Left, *Right);
+                    DeallocateDistribution(Left);
+                    DeallocateDistribution(Right);
+                    *Left = Sum;
+                    --Top;
+                }
+            } break;
+
+            case DiceOpMultiply:
+            case DiceOpDivide: {
+                distribution* Left = &Stack[Top - 1];
+                distribution* Right = &Stack[Top];
+                distribution Combined = {};
+                Result = CombineDistributionsPairwise(*Left, *Right, Instruction->Opcode == DiceOpDivide, &Combined, ErrorMessage);
+                if(Result) {
+                    DeallocateDistribution(Left);
+                    DeallocateDistribution(Right);
+                    *Left = Combined;
+                    --Top;
+                }
+            } break;
+        }
+    }
+
+    if(Result) {
+        *Total = Stack[0];
+        Stack[0] = {};
+        if(Program->Comparison != TokenTypeNone) {
+            *Target = Stack[1];
+            Stack[1] = {};
+        }
+    }
+
+    for(s32 Index = 0; Index <= Top; ++Index) {
+        DeallocateDistribution(&Stack[Index]);
+    }
+
+    return Result;
+}
+
+// P(Total Comparison Target), for a program with a comparison
+internal r64
+ComparisonProbability(distribution Total, distribution Target, token_type Comparison) {
+    // Compare the difference of the two sides to zero
+    distribution NegatedTarget = NegateDistribution(Target);
+    distribution Difference = ConvolveDistributions(Total, NegatedTarget);
+
+    r64 Result = 0;
+    switch(Comparison) {
+        case TokenTypeGreaterEqual: Result = ProbabilityAtLeast(Difference, 0);     break;
+        case TokenTypeGreater:      Result = ProbabilityAtLeast(Difference, 1);     break;
+        case TokenTypeLess:         Result = 1 - ProbabilityAtLeast(Difference, 0); break;
+        case TokenTypeLessEqual:    Result = 1 - ProbabilityAtLeast(Difference, 1); break;
+        default: Unreachable;
+    }
+
+    DeallocateDistribution(&Difference);
+    DeallocateDistribution(&NegatedTarget);
+    return Result;
+}
@@ -0,0 +1,827 @@
+/*
+  File: dice-roll.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// NOTE: Everything here is a template on the random engine (see random.h) so
+// that the loops get compiled for each engine.
+
+struct dice_summary {
+    s64 Total;
+    s32 Max;
+    s32 Min;
+};
+
+// Past this many dice per side it is cheaper to sample how many times each face
+// came up than to roll every die.
+#define DirectRollDicePerSide 4
+
+template<class random_state> internal dice_summary
+RollDiceDirectSummary(random_state* RandomState, s64 Count, s32 NumSides) {
+    dice_summary Result = {};
+    Result.Min = NumSides;
+
+    u32 Rolls[256];
+    for(s64 RollIndex = 0; RollIndex < Count; RollIndex += ArrayLength(Rolls)) {
+        s64 NumRolls = Count - RollIndex;
+        if(NumRolls > (s64)ArrayLength(Rolls)) {
+            NumRolls = ArrayLength(Rolls);
+        }
+
+        RollDice(RandomState, NumSides, NumRolls, Rolls);
+
+        for(s64 Index = 0; Index < NumRolls; ++Index) {
+            s32 Num = Rolls[Index];
+            Result.Total += Num;
+            Result.Max = Num > Result.Max ? Num : Result.Max;
+            Result.Min = Num < Result.Min ? Num : Result.Min;
+        }
+    }
+
+    return Result;
+}
+
+// Samples total, max and min of Count dice without rolling them one by one.
+// The number of dice showing each face is multinomial, which is drawn as a
+// chain of binomials: of the dice not yet assigned, each one shows the next face
+// with probability 1 / (faces left). The cost only depends on NumSides, and the
+// total, max and min come from the same sample so they are consistent.
+template<class random_state> internal dice_summary
+RollDiceSummary(random_state* RandomState, s64 Count, s32 NumSides) {
+    dice_summary Result = {};
+
+    if(Count <= (s64)NumSides * DirectRollDicePerSide) {
+        Result = RollDiceDirectSummary(RandomState, Count, NumSides);
+    } else {
+        Result.Min = NumSides;
+
+        s64 Remaining = Count;
+        for(s32 Face = 1; Face <= NumSides && Remaining > 0; ++Face) {
+            s64 FaceCount = Remaining;
+            if(Face < NumSides) {
+                FaceCount = SampleBinomial(RandomState, Remaining, 1.0 / (r64)(NumSides - Face + 1));
+            }
+
+            if(FaceCount > 0) {
+                Result.Total += FaceCount * Face;
+                Result.Min = Face < Result.Min ? Face : Result.Min;
+                Result.Max = Face;
+                Remaining -= FaceCount;
+            }
+        }
+    }
+
+    return Result;
+}
+
+// --- Summaries of large rolls
+//
+// Statistics of a roll that are built as the dice come in, without keeping
+// them: the total in 64 bits, min, max, the mean and variance with Welford's
+// update, and a histogram of the faces that has at most DiceHistogramRows rows.
+
+#define DiceHistogramRows 20
+#define DiceHistogramBarWidth 40
+
+struct dice_stats {
+    s64 Count;
+    s64 Total;
+    s32 Min;
+    s32 Max;
+    r64 Mean;
+    r64 SumSquaredDeviations; // Welford's M2, the variance times Count
+
+    s32 BucketWidth; // Faces in each row of the histogram
+    s64 Buckets[DiceHistogramRows];
+};
+
+internal dice_stats
+NewDiceStats(s32 NumSides) {
+    dice_stats Result = {};
+    Result.Min = NumSides;
+    Result.BucketWidth = (NumSides + DiceHistogramRows - 1) / DiceHistogramRows;
+    return Result;
+}
+
+// Count dice showing Face, added in one weighted Welford step
+internal void
+AddDiceToStats(dice_stats* Stats, s32 Face, s64 Count) {
+    if(Count > 0) {
+        s64 NewCount = Stats->Count + Count;
+        r64 Delta = (r64)Face - Stats->Mean;
+        Stats->Mean += Delta * (r64)Count / (r64)NewCount;
+        Stats->SumSquaredDeviations += Delta * (r64)Count * ((r64)Face - Stats->Mean);
+        Stats->Count = NewCount;
+
+        Stats->Total += Count * Face;
+        Stats->Min = Face < Stats->Min ? Face : Stats->Min;
+        Stats->Max = Face > Stats->Max ? Face : Stats->Max;
+        Stats->Buckets[(Face - 1) / Stats->BucketWidth] += Count;
+    }
+}
+
+// A block of rolls gets its own mean and M2 first, which are then merged in
+// (Chan et al.). It is exact and takes one division per block instead of one
+// per die.
+internal void
+AddRollsToStats(dice_stats* Stats, u32* Rolls, s64 NumRolls) {
+    if(NumRolls > 0) {
+        s64 Sum = 0;
+        s32 Min = Stats->Min;
+        s32 Max = Stats->Max;
+        for(s64 Index = 0; Index < NumRolls; ++Index) {
+            s32 Face = Rolls[Index];
+            Sum += Face;
+            Min = Face < Min ? Face : Min;
+            Max = Face > Max ? Face : Max;
+        }
+
+        if(Stats->BucketWidth == 1) {
+            for(s64 Index = 0; Index < NumRolls; ++Index) {
+                ++Stats->Buckets[Rolls[Index] - 1];
+            }
+        } else {
+            for(s64 Index = 0; Index < NumRolls; ++Index) {
+                ++Stats->Buckets[(Rolls[Index] - 1) / Stats->BucketWidth];
+            }
+        }
+
+        r64 BlockMean = (r64)Sum / (r64)NumRolls;
+        r64 BlockSumSquaredDeviations = 0;
+        for(s64 Index = 0; Index < NumRolls; ++Index) {
+            r64 Deviation = (r64)Rolls[Index] - BlockMean;
+            BlockSumSquaredDeviations += Deviation * Deviation;
+        }
+
+        s64 NewCount = Stats->Count + NumRolls;
+        r64 Delta = BlockMean - Stats->Mean;
+        Stats->Mean += Delta * (r64)NumRolls / (r64)NewCount;
+        Stats->SumSquaredDeviations += BlockSumSquaredDeviations +
+                                       Delta * Delta * (r64)Stats->Count * (r64)NumRolls / (r64)NewCount;
+        Stats->Count = NewCount;
+
+        Stats->Total += Sum;
+        Stats->Min = Min;
+        Stats->Max = Max;
+    }
+}
+
+// Statistics of Count dice. Like RollDiceSummary, large pools come from how
+// many dice showed each face instead of from every die.
+template<class random_state> internal dice_stats
+RollDiceStats(random_state* RandomState, s64 Count, s32 NumSides) {
+    dice_stats Result = NewDiceStats(NumSides);
+
+    if(Count <= (s64)NumSides * DirectRollDicePerSide) {
+        u32 Rolls[256];
+        for(s64 RollIndex = 0; RollIndex < Count; RollIndex += ArrayLength(Rolls)) {
+            s64 NumRolls = Count - RollIndex;
+            if(NumRolls > (s64)ArrayLength(Rolls)) {
+                NumRolls = ArrayLength(Rolls);
+            }
+
+            RollDice(RandomState, NumSides, NumRolls, Rolls);
+            AddRollsToStats(&Result, Rolls, NumRolls);
+        }
+    } else {
+        s64 Remaining = Count;
+        for(s32 Face = 1; Face <= NumSides && Remaining > 0; ++Face) {
+            s64 FaceCount = Remaining;
+            if(Face < NumSides) {
+                FaceCount = SampleBinomial(RandomState, Remaining, 1.0 / (r64)(NumSides - Face + 1));
+            }
+            AddDiceToStats(&Result, Face, FaceCount);
+            Remaining -= FaceCount;
+        }
+    }
+
+    return Result;
+}
+
+// One row per face, or per range of faces when there are more than
+// DiceHistogramRows. The longest bar is DiceHistogramBarWidth long.
+internal void
+PrintDiceStats(dice_stats* Stats, s32 NumSides) {
+    r64 Variance = Stats->Count > 0 ? Stats->SumSquaredDeviations / (r64)Stats->Count : 0;
+    Print("  Total: %lld\r\n"
+          "  Max: %d\r\n"
+          "  Min: %d\r\n"
+          "  Mean: %.3f\r\n"
+          "  Variance: %.3f (std dev %.3f)\r\n",
+          (long long)Stats->Total, Stats->Max, Stats->Min, Stats->Mean, Variance, sqrt(Variance));
+
+    s32 NumRows = (NumSides + Stats->BucketWidth - 1) / Stats->BucketWidth;
+    s64 Largest = 1;
+    for(s32 Row = 0; Row < NumRows; ++Row) {
+        Largest = Stats->Buckets[Row] > Largest ? Stats->Buckets[Row] : Largest;
+    }
+
+    // The last label is the widest
+    char Labels[DiceHistogramRows][32];
+    s32 LabelWidth = 0;
+    for(s32 Row = 0; Row < NumRows; ++Row) {
+        s64 First = (s64)Row * Stats->BucketWidth + 1;
+        s64 Last = First + Stats->BucketWidth - 1;
+        Last = Last < NumSides ? Last : NumSides;
+
+        if(First == Last) {
+            LabelWidth = snprintf(Labels[Row], sizeof(Labels[Row]), "%lld", (long long)First);
+        } else {
+            LabelWidth = snprintf(Labels[Row], sizeof(Labels[Row]), "%lld-%lld", (long long)First, (long long)Last);
+        }
+    }
+
+    char Bar[DiceHistogramBarWidth + 1];
+    memset(Bar, '#', DiceHistogramBarWidth);
+    Bar[DiceHistogramBarWidth] = 0;
+
+    for(s32 Row = 0; Row < NumRows; ++Row) {
+        s64 InRow = Stats->Buckets[Row];
+        s32 BarLength = (s32)((InRow * DiceHistogramBarWidth + Largest / 2) / Largest);
+        if(BarLength == 0 && InRow > 0) {
+            BarLength = 1;
+        }
+        Print("  %*s: %7.3f%% %.*s\r\n", LabelWidth, Labels[Row], 100.0 * (r64)InRow / (r64)Stats->Count, BarLength, Bar);
+    }
+}
+
+// --- Keeping the highest or lowest dice
+
+// Up to this many faces the per-face counts live on the stack
+#define KeepCountsStackFaces 256
+
+// Working memory for dice too big for the stack. PushDiceScratch sizes it for
+// every set of dice in a program up front, so rolling never allocates. Threads
+// rolling the same program each need their own.
+struct dice_scratch {
+    s64* Counts; // One per face, for dice with more than KeepCountsStackFaces faces
+    u32* Rolls;  // For kept dice with more faces than dice, which are sorted
+};
+
+// Counts[Face - 1] is set to how many of Count dice showed Face. Like
+// RollDiceSummary, large pools are sampled as a chain of binomials instead of
+// rolling every die.
+template<class random_state> internal void
+CountDiceFaces(random_state* RandomState, s64 Count, s32 NumSides, s64* Counts) {
+    ClearBytes(Counts, sizeof(s64) * NumSides);
+
+    if(Count <= (s64)NumSides * DirectRollDicePerSide) {
+        u32 Rolls[256];
+        for(s64 RollIndex = 0; RollIndex < Count; RollIndex += ArrayLength(Rolls)) {
+            s64 NumRolls = Count - RollIndex;
+            if(NumRolls > (s64)ArrayLength(Rolls)) {
+                NumRolls = ArrayLength(Rolls);
+            }
+
+            RollDice(RandomState, NumSides, NumRolls, Rolls);
+            for(s64 Index = 0; Index < NumRolls; ++Index) {
+                ++Counts[Rolls[Index] - 1];
+            }
+        }
+    } else {
+        s64 Remaining = Count;
+        for(s32 Face = 1; Face <= NumSides && Remaining > 0; ++Face) {
+            s64 FaceCount = Remaining;
+            if(Face < NumSides) {
+                FaceCount = SampleBinomial(RandomState, Remaining, 1.0 / (r64)(NumSides - Face + 1));
+            }
+            Counts[Face - 1] = FaceCount;
+            Remaining -= FaceCount;
+        }
+    }
+}
+
+// Total of the NumKept highest (or lowest) of Rolls, which get sorted
+internal s64
+SortedKeptTotal(array<u32> Rolls, s64 NumKept, b32 KeepLowest) {
+    array<u32> Buffer = AllocateArray<u32>(Rolls.Length);
+    RadixSort(Rolls, Buffer, Identity<u32>);
+    Deallocate(Buffer);
+
+    s64 Result = 0;
+    s64 First = KeepLowest ? 0 : Rolls.Length - NumKept;
+    for(s64 Index = First; Index < First + NumKept; ++Index) {
+        Result += Rolls.Contents[Index];
+    }
+    return Result;
+}
+
+// Total of the NumKept highest (or lowest) of Count dice. Nothing gets sorted:
+// there are usually far fewer faces than dice, so the dice showing each face
+// are counted and the kept ones are taken from the top (or bottom) face down.
+// Only when there are more faces than dice are the rolls sorted instead.
+template<class random_state> internal s64
+RollKeptDiceTotal(random_state* RandomState, s64 Count, s32 NumSides, s64 NumKept, b32 KeepLowest, dice_scratch* Scratch) {
+    s64 Result = 0;
+    if(NumSides <= KeepCountsStackFaces || NumSides <= Count) {
+        s64 StackCounts[KeepCountsStackFaces];
+        s64* Counts = NumSides > KeepCountsStackFaces ? Scratch->Counts : StackCounts;
+
+        CountDiceFaces(RandomState, Count, NumSides, Counts);
+
+        s64 Remaining = NumKept;
+        for(s32 Index = 0; Index < NumSides && Remaining > 0; ++Index) {
+            s32 Face = KeepLowest ? Index + 1 : NumSides - Index;
+            s64 Taken = Counts[Face - 1] < Remaining ? Counts[Face - 1] : Remaining;
+            Result += Taken * Face;
+            Remaining -= Taken;
+        }
+    } else {
+        array<u32> Rolls = { (int_size)Count, Scratch->Rolls };
+        RollDice(RandomState, NumSides, Count, Rolls.Contents);
+        Result = SortedKeptTotal(Rolls, NumKept, KeepLowest);
+    }
+    return Result;
+}
+
+// Rolls of more dice than this only show the total, max and min
+#define DicePrintLimit 100
+
+struct dice_result {
+    s64 Total;      // Of the whole program, or of the left side of the comparison
+    s64 Target;     // The right side of the comparison
+    b32 Succeeded;  // Whether the comparison was true
+    b32 DividedByZero;
+};
+
+internal void
+PrintDiceLabel(dice_set Dice) {
+    WriteLiteral(&Output, "  ");
+    WriteInt(&Output, Dice.Count);
+    WriteByte(&Output, 'd');
+    WriteInt(&Output, Dice.NumSides);
+    if(Dice.RerollBelow > 0) {
+        WriteByte(&Output, 'r');
+        WriteInt(&Output, Dice.RerollBelow);
+    }
+    if(Dice.NumKept > 0) {
+        WriteByte(&Output, 'k');
+        WriteByte(&Output, Dice.KeepLowest ? 'l' : 'h');
+        WriteInt(&Output, Dice.NumKept);
+    }
+    if(Dice.Explodes) {
+        WriteByte(&Output, '!');
+    }
+    if(Dice.SuccessComparison != TokenTypeNone) {
+        WriteByte(&Output, '#');
+        WriteText(&Output, StringFromC(ComparisonString(Dice.SuccessComparison)));
+        WriteInt(&Output, Dice.SuccessTarget);
+    }
+    WriteByte(&Output, ':');
+}
+
+// --- Exploding and success-counting pools
+//
+// Rerolling the faces up to RerollBelow until they stop coming up is the same
+// as rolling a die with the rest of the faces, so dice that reroll are rolled
+// with NumSides - RerollBelow sides and RerollBelow is added to every face.
+
+// Every die showing its highest face adds another die, for at most this many
+// rounds. Stops a long run from taking forever and bounds the totals for
+// 'dist' and 'sim'. Past 100 rounds the odds of going on are negligible for
+// any die with more than one face left.
+#define MaxExplosions 100
+
+// Faces from Low to High count as successes. Empty when successes aren't counted.
+internal void
+GetSuccessFaces(dice_set Dice, s32* Low, s32* High) {
+    s64 First = 1;
+    s64 Last = 0;
+    switch(Dice.SuccessComparison) {
+        case TokenTypeGreater:      First = (s64)Dice.SuccessTarget + 1; Last = Dice.NumSides; break;
+        case TokenTypeGreaterEqual: First = Dice.SuccessTarget;          Last = Dice.NumSides; break;
+        case TokenTypeLess:         First = 1; Last = (s64)Dice.SuccessTarget - 1;             break;
+        case TokenTypeLessEqual:    First = 1; Last = Dice.SuccessTarget;                      break;
+        default: break;
+    }
+    *Low = (s32)(First < 1 ? 1 : First);
+    *High = (s32)(Last > Dice.NumSides ? Dice.NumSides : Last);
+}
+
+struct dice_tally {
+    s64 Total;
+    s64 NumHighest;   // Dice showing the highest face, which explode
+    s64 NumSuccesses; // Dice showing a face from SuccessLow to SuccessHigh
+};
+
+// Tallies rolls from 1 to HighestFace four at a time: the total is added up in
+// 64 bits, and the dice that explode or succeed are compared for and counted
+// from the comparison masks.
+internal dice_tally
+TallyDice(u32* Rolls, s64 Count, s32 HighestFace, s32 SuccessLow, s32 SuccessHigh) {
+    dice_tally Result = {};
+    s64 Index = 0;
+#if defined(__x86_64__)
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Highest = _mm_set1_epi32(HighestFace);
+    __m128i Low = _mm_set1_epi32(SuccessLow);
+    __m128i High = _mm_set1_epi32(SuccessHigh);
+    __m128i Sum = Zero;
+    for(; Index + 4 <= Count; Index += 4) {
+        __m128i Faces = _mm_loadu_si128((__m128i*)(Rolls + Index));
+        Sum = _mm_add_epi64(Sum, _mm_unpacklo_epi32(Faces, Zero));
+        Sum = _mm_add_epi64(Sum, _mm_unpackhi_epi32(Faces, Zero));
+
+        // Faces are at most NumSides, so they compare the same signed
+        __m128i IsHighest = _mm_cmpeq_epi32(Faces, Highest);
+        __m128i Failed = _mm_or_si128(_mm_cmpgt_epi32(Low, Faces), _mm_cmpgt_epi32(Faces, High));
+        Result.NumHighest += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(IsHighest)));
+        Result.NumSuccesses += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(Failed)));
+    }
+
+    u64 Lanes[2];
+    _mm_storeu_si128((__m128i*)Lanes, Sum);
+    Result.Total = Lanes[0] + Lanes[1];
+#endif
+
+    for(; Index < Count; ++Index) {
+        s32 Face = Rolls[Index];
+        Result.Total += Face;
+        Result.NumHighest += (Face == HighestFace);
+        Result.NumSuccesses += (Face >= SuccessLow && Face <= SuccessHigh);
+    }
+    return Result;
+}
+
+// Total of Dice, or the number of dice that succeeded when successes are
+// counted. The extra dice from explosions are rolled a round at a time: each
+// round is as many dice as showed the highest face in the one before. Large
+// rounds are counted face by face like CountDiceFaces instead of rolled.
+template<b32 ShowRolls, class random_state> internal s64
+RollDicePool(random_state* RandomState, dice_set Dice, dice_scratch* Scratch) {
+    s32 Offset = Dice.RerollBelow;
+    s32 NumSides = Dice.NumSides - Offset;
+    s32 SuccessLow, SuccessHigh;
+    GetSuccessFaces(Dice, &SuccessLow, &SuccessHigh);
+    b32 CountsSuccesses = (Dice.SuccessComparison != TokenTypeNone);
+
+    s64 Result = 0;
+    if(!ShowRolls || Dice.Count > DicePrintLimit) {
+        dice_tally Pool = {};
+        s64 NumRolled = 0;
+        s64 Pending = Dice.Count;
+        for(s32 Round = 0; Round <= MaxExplosions && Pending > 0; ++Round) {
+            dice_tally Tally = {};
+            if(Pending > (s64)NumSides * DirectRollDicePerSide) {
+                s64 StackCounts[KeepCountsStackFaces];
+                s64* Counts = NumSides > KeepCountsStackFaces ? Scratch->Counts : StackCounts;
+
+                CountDiceFaces(RandomState, Pending, NumSides, Counts);
+                for(s32 Face = 1; Face <= NumSides; ++Face) {
+                    Tally.Total += Counts[Face - 1] * Face;
+                    if(Face + Offset >= SuccessLow && Face + Offset <= SuccessHigh) {
+                        Tally.NumSuccesses += Counts[Face - 1];
+                    }
+                }
+                Tally.NumHighest = Counts[NumSides - 1];
+            } else {
+                u32 Rolls[256];
+                for(s64 RollIndex = 0; RollIndex < Pending; RollIndex += ArrayLength(Rolls)) {
+                    s64 NumRolls = Pending - RollIndex;
+                    if(NumRolls > (s64)ArrayLength(Rolls)) {
+                        NumRolls = ArrayLength(Rolls);
+                    }
+
+                    RollDice(RandomState, NumSides, NumRolls, Rolls);
+                    dice_tally Block = TallyDice(Rolls, NumRolls, NumSides, SuccessLow - Offset, SuccessHigh - Offset);
+                    Tally.Total += Block.Total;
+                    Tally.NumHighest += Block.NumHighest;
+                    Tally.NumSuccesses += Block.NumSuccesses;
+                }
+            }
+
+            Pool.Total += Tally.Total + Pending * Offset;
+            Pool.NumSuccesses += Tally.NumSuccesses;
+            NumRolled += Pending;
+            Pending = Dice.Explodes ? Tally.NumHighest : 0;
+        }
+        Result = CountsSuccesses ? Pool.NumSuccesses : Pool.Total;
+
+        if(ShowRolls) {
+            PrintDiceLabel(Dice);
+            Print(" %lld (%lld rolls not shown)\r\n", (long long)Result, (long long)NumRolled);
+        }
+    } else {
+        // Each die keeps the faces it rolled in order, so the ones that
+        // exploded can be shown as one chain (ex. 6+6+2)
+        u32 Faces[MaxExplosions + 1][DicePrintLimit];
+        s32 ChainLength[DicePrintLimit];
+        s32 Exploding[DicePrintLimit];
+        s32 NumExploding = Dice.Count;
+        for(s32 Die = 0; Die < Dice.Count; ++Die) {
+            Exploding[Die] = Die;
+        }
+
+        u32 Rolls[DicePrintLimit];
+        for(s32 Round = 0; Round <= MaxExplosions && NumExploding > 0; ++Round) {
+            RollDice(RandomState, NumSides, NumExploding, Rolls);
+
+            // The dice that explode again are packed to the front for the next round
+            s32 NumStillExploding = 0;
+            for(s32 Index = 0; Index < NumExploding; ++Index) {
+                s32 Die = Exploding[Index];
+                Faces[Round][Die] = Rolls[Index] + Offset;
+                ChainLength[Die] = Round + 1;
+                Exploding[NumStillExploding] = Die;
+                NumStillExploding += (Dice.Explodes && Rolls[Index] == (u32)NumSides);
+            }
+            NumExploding = NumStillExploding;
+        }
+
+        // Dice that succeed are marked with a *
+        PrintDiceLabel(Dice);
+        for(s32 Die = 0; Die < Dice.Count; ++Die) {
+            WriteLiteral(&Output, "  ");
+            for(s32 Round = 0; Round < ChainLength[Die]; ++Round) {
+                s32 Face = Faces[Round][Die];
+                b32 Succeeded = (Face >= SuccessLow && Face <= SuccessHigh);
+                if(Round > 0) {
+                    WriteByte(&Output, '+');
+                }
+                WriteInt(&Output, Face);
+                if(Succeeded) {
+                    WriteByte(&Output, '*');
+                }
+                Result += CountsSuccesses ? Succeeded : Face;
+            }
+        }
+        WriteLiteral(&Output, "\r\n");
+    }
+    return Result;
+}
+
+// Total of Dice, or the number of them that succeeded when successes are
+// counted. With ShowRolls the rolls are printed as they are made.
+template<b32 ShowRolls, class random_state> internal s64
+RollDiceTotal(random_state* RandomState, dice_set Dice, dice_scratch* Scratch) {
+    s64 Result = 0;
+    if(Dice.NumKept == Dice.Count) {
+        // Keeping every die is the same as not choosing
+        Dice.NumKept = 0;
+    }
+
+    s32 Count = Dice.Count;
+    s32 NumKept = Dice.NumKept;
+    b32 KeepLowest = Dice.KeepLowest;
+    s32 Offset = Dice.RerollBelow;
+    s32 NumSides = Dice.NumSides - Offset;
+
+    if(Dice.Explodes || Dice.SuccessComparison != TokenTypeNone) {
+        Result = RollDicePool<ShowRolls>(RandomState, Dice, Scratch);
+    } else if(!ShowRolls || Count > DicePrintLimit) {
+        if(NumKept > 0) {
+            Result = RollKeptDiceTotal(RandomState, Count, NumSides, NumKept, KeepLowest, Scratch) + (s64)NumKept * Offset;
+        } else {
+            Result = RollDiceSummary(RandomState, Count, NumSides).Total + (s64)Count * Offset;
+        }
+
+        if(ShowRolls) {
+            PrintDiceLabel(Dice);
+            Print(" %lld (%d rolls not shown)\r\n", (long long)Result, Count);
+        }
+    } else {
+        u32 Rolls[DicePrintLimit];
+        RollDice(RandomState, NumSides, Count, Rolls);
+
+        PrintDiceLabel(Dice);
+        for(s32 Index = 0; Index < Count; ++Index) {
+            Rolls[Index] += Offset;
+            WriteLiteral(&Output, "  ");
+            WriteInt(&Output, Rolls[Index]);
+            Result += Rolls[Index];
+        }
+
+        if(NumKept > 0) {
+            // The kept dice are listed in order after all of the rolls
+            array<u32> Sorted = { Count, Rolls };
+            Result = SortedKeptTotal(Sorted, NumKept, KeepLowest);
+
+            s32 First = KeepLowest ? 0 : Count - NumKept;
+            WriteLiteral(&Output, "  (kept");
+            for(s32 Index = First; Index < First + NumKept; ++Index) {
+                WriteByte(&Output, ' ');
+                WriteInt(&Output, Rolls[Index]);
+            }
+            WriteByte(&Output, ')');
+        }
+        WriteLiteral(&Output, "\r\n");
+    }
+    return Result;
+}
+
+// Scratch for every set of dice in Program, see dice_scratch
+internal dice_scratch
+PushDiceScratch(memory_arena* Arena, dice_program* Program) {
+    s64 MaxFaces = 0;
+    s64 MaxSortedRolls = 0;
+    for(s32 Index = 0; Index < Program->NumInstructions; ++Index) {
+        dice_instruction* Instruction = &Program->Instructions[Index];
+        if(Instruction->Opcode == DiceOpRoll) {
+            dice_set Dice = Instruction->Dice;
+            s64 NumSides = Dice.NumSides - Dice.RerollBelow;
+            if(NumSides > KeepCountsStackFaces) {
+                // The same choice RollKeptDiceTotal and RollDicePool make
+                if(NumSides <= Dice.Count) {
+                    MaxFaces = NumSides > MaxFaces ? NumSides : MaxFaces;
+                } else if(Dice.NumKept > 0) {
+                    MaxSortedRolls = Dice.Count > MaxSortedRolls ? Dice.Count : MaxSortedRolls;
+                }
+            }
+        }
+    }
+
+    dice_scratch Result = {};
+    if(MaxFaces > 0) {
+        Result.Counts = PushTyped<s64>(Arena, MaxFaces);
+    }
+    if(MaxSortedRolls > 0) {
+        Result.Rolls = PushTyped<u32>(Arena, MaxSortedRolls);
+    }
+    return Result;
+}
+
+// Runs a program made by CompileDiceProgram. Scratch comes from PushDiceScratch.
+template<b32 ShowRolls, class random_state> internal dice_result
+RunDiceProgram(dice_program* Program, random_state* RandomState, dice_scratch* Scratch) {
+    dice_result Result = {};
+    s64 Stack[MaxDiceStackDepth];
+    s64* Top = Stack - 1;
+
+    dice_instruction* Instruction = Program->Instructions;
+    dice_instruction* End = Instruction + Program->NumInstructions;
+    for(; Instruction < End; ++Instruction) {
+        switch(Instruction->Opcode) {
+            case DiceOpPush: {
+                *++Top = Instruction->Value;
+            } break;
+
+            case DiceOpRoll: {
+                *++Top = RollDiceTotal<ShowRolls>(RandomState, Instruction->Dice, Scratch);
+            } break;
+
+            case DiceOpNegate: {
+                *Top = -*Top;
+            } break;
+
+            case DiceOpAdd:      { Top[-1] += Top[0]; --Top; } break;
+            case DiceOpSubtract: { Top[-1] -= Top[0]; --Top; } break;
+            case DiceOpMultiply: { Top[-1] *= Top[0]; --Top; } break;
+
+            case DiceOpDivide: {
+                if(Top[0] == 0) {
+                    Result.DividedByZero = true;
+                    Top[0] = 1;
+                }
+                Top[-1] /= Top[0];
+                --Top;
+            } break;
+        }
+    }
+
+    Result.Total = Stack[0];
+    if(Program->Comparison != TokenTypeNone) {
+        Result.Target = Stack[1];
+        Result.Succeeded = Compare(Program->Comparison, Result.Total, Result.Target);
+    }
+
+    return Result;
+}
+
+// Smallest and largest possible Total of a program, ignoring division by zero.
+// Returns false if some value along the way could be too large for an s64,
+// in which case the rolls would wrap around and the program can't be trusted.
+internal b32
+DiceProgramRange(dice_program* Program, s64* Min, s64* Max) {
+    s64 Low[MaxDiceStackDepth];
+    s64 High[MaxDiceStackDepth];
+    s32 Top = -1;
+    b32 Overflowed = false;
+
+    for(s32 Index = 0; Index < Program->NumInstructions && !Overflowed; ++Index) {
+        dice_instruction* Instruction = &Program->Instructions[Index];
+        switch(Instruction->Opcode) {
+            case DiceOpPush: {
+                ++Top;
+                Low[Top] = High[Top] = Instruction->Value;
+            } break;
+
+            case DiceOpRoll: {
+                dice_set Dice = Instruction->Dice;
+                s64 NumCounted = Dice.NumKept > 0 ? Dice.NumKept : Dice.Count;
+                s64 MostPerDie = Dice.SuccessComparison != TokenTypeNone ? 1 : Dice.NumSides;
+                s64 Rolls = Dice.Explodes ? MaxExplosions + 1 : 1;
+                ++Top;
+                if(Dice.SuccessComparison != TokenTypeNone) {
+                    Low[Top] = 0;
+                } else {
+                    Overflowed |= __builtin_mul_overflow(NumCounted, (s64)Dice.RerollBelow + 1, &Low[Top]);
+                }
+                Overflowed |= __builtin_mul_overflow(NumCounted, MostPerDie, &High[Top]);
+                Overflowed |= __builtin_mul_overflow(High[Top], Rolls, &High[Top]);
+            } break;
+
+            case DiceOpNegate: {
+                s64 OldLow = Low[Top];
+                Overflowed |= __builtin_sub_overflow((s64)0, High[Top], &Low[Top]);
+                Overflowed |= __builtin_sub_overflow((s64)0, OldLow, &High[Top]);
+            } break;
+
+            case DiceOpAdd: {
+                --Top;
+                Overflowed |= __builtin_add_overflow(Low[Top], Low[Top + 1], &Low[Top]);
+                Overflowed |= __builtin_add_overflow(High[Top], High[Top + 1], &High[Top]);
+            } break;
+
+            case DiceOpSubtract: {
+                --Top;
+                Overflowed |= __builtin_sub_overflow(Low[Top], High[Top + 1], &Low[Top]);
+                Overflowed |= __builtin_sub_overflow(High[Top], Low[Top + 1], &High[Top]);
+            } break;
+
+            case DiceOpMultiply:
+            case DiceOpDivide: {
+                --Top;
+                s64 LeftLow = Low[Top], LeftHigh = High[Top];
+                s64 RightLow = Low[Top + 1], RightHigh = High[Top + 1];
+
+                // The extremes are at the ends of the ranges. Dividing skips
+                // zero, so the divisor's ends closest to it count as well.
+                s64 Divisors[4] = { RightLow, RightHigh, RightLow, RightHigh };
+                s32 NumDivisors = 2;
+                if(Instruction->Opcode == DiceOpDivide) {
+                    NumDivisors = 0;
+                    s64 Candidates[4] = { RightLow, RightHigh, -1, 1 };
+                    for(s32 Candidate = 0; Candidate < 4; ++Candidate) {
+                        s64 Divisor = Candidates[Candidate];
+                        if(Divisor != 0 && Divisor >= RightLow && Divisor <= RightHigh) {
+                            Divisors[NumDivisors++] = Divisor;
+                        }
+                    }
+                    if(NumDivisors == 0) {
+                        // Always divides by zero
+                        Divisors[NumDivisors++] = 1;
+                    }
+                }
+
+                b32 First = true;
+                s64 Lefts[2] = { LeftLow, LeftHigh };
+                for(s32 LeftIndex = 0; LeftIndex < 2; ++LeftIndex) {
+                    for(s32 RightIndex = 0; RightIndex < NumDivisors; ++RightIndex) {
+                        s64 Value = 0;
+                        if(Instruction->Opcode == DiceOpMultiply) {
+                            Overflowed |= __builtin_mul_overflow(Lefts[LeftIndex], Divisors[RightIndex], &Value);
+                        } else if(Lefts[LeftIndex] == INT64_MIN && Divisors[RightIndex] == -1) {
+                            Overflowed = true;
+                        } else {
+                            Value = Lefts[LeftIndex] / Divisors[RightIndex];
+                        }
+
+                        if(First || Value < Low[Top]) {
+                            Low[Top] = Value;
+                        }
+                        if(First || Value > High[Top]) {
+                            High[Top] = Value;
+                        }
+                        First = false;
+                    }
+                }
+            } break;
+        }
+    }
+
+    *Min = Low[0];
+    *Max = High[0];
+    return !Overflowed;
+}
+
+// Buckets for a histogram of the totals from Min to Max, at most MaxBuckets of
+// them, each BucketWidth totals wide. Worked out in u64, since Max - Min can
+// be more than an s64 holds.
+internal void
+SizeTotalHistogram(s64 Min, s64 Max, s32 MaxBuckets, s64* BucketWidth, s32* NumBuckets) {
+    u64 Span = (u64)Max - (u64)Min; // One less than the number of totals
+    u64 Width = Span / (u64)MaxBuckets + 1;
+    *BucketWidth = (s64)Width;
+    *NumBuckets = (s32)(Span / Width + 1);
+}
+
+// First total in a bucket. Bucket * BucketWidth can be past INT64_MAX when
+// Min is negative, so it wraps around in u64 back into range.
+internal inline s64
+TotalHistogramBucketStart(s32 Bucket, s64 Min, s64 BucketWidth) {
+    s64 Result = (s64)((u64)Min + (u64)Bucket * (u64)BucketWidth);
+    return Result;
+}
+
+// Clamped to the histogram, so a total outside the range can't write past it
+internal inline s32
+TotalHistogramBucket(s64 Total, s64 Min, s64 BucketWidth, s32 NumBuckets) {
+    s32 Result = 0;
+    if(Total > Min) {
+        u64 Bucket = ((u64)Total - (u64)Min) / (u64)BucketWidth;
+        Result = Bucket < (u64)NumBuckets ? (s32)Bucket : NumBuckets - 1;
+    }
+    return Result;
+}
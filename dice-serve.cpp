@@ -0,0 +1,615 @@
+/*
+  File: dice-serve.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// --serve SOCKET answers commands from any number of clients on a Unix-domain
+// socket. It is one thread waiting on the same epoll set as the prompt. Each
+// connection reads into its own buffer without blocking, and every whole line
+// in it is run as a command, the same as a line of a script. The reply is what
+// the command printed, with \n line endings, followed by a line holding only
+// "." so the client knows where it ends. "quit" closes the connection.
+//
+// Commands run on the epoll thread and each reply is made before anything else
+// is read, so a slow command holds up every client until it is done. 'sim'
+// is limited to ServeMaxSimDice dice and 'dist' to ServeMaxDistributionLength
+// totals for that reason, and 'watch' needs the prompt.
+//
+// Every connection rolls with its own engine. Connection N, counting from 0 in
+// the order they were accepted, is seeded with the Nth value derived from
+// --seed, so a session can be replayed by making the same connections in the
+// same order.
+//
+// --load SOCKET is the other end: it opens many connections to a server, keeps
+// one command in flight on each and reports how long the replies took.
+
+#define ServeEventsPerWait 256
+#define ServeInitialInputSize 4096
+
+// Lines longer than this get an error and are skipped
+#define ServeMaxLineLength Kilobytes(64)
+
+// Keeps the largest 'sim' a client can ask for to a fraction of a second
+#define ServeMaxSimDice 10000000
+
+// The same for 'dist': totals in one distribution, and work for kept dice
+#define ServeMaxDistributionLength (1 << 18)
+#define ServeMaxKeptDistributionWork (1LL << 27)
+
+// In main.cpp
+template<class random_state> internal b32
+ExecuteCommand(string Command, random_state* RandomState, memory_arena* Arena);
+
+struct serve_connection {
+    s32 FileDescriptor;
+    random_engine_state RandomState;
+
+    // Bytes read that don't make up a whole line yet. There is always room
+    // for one more byte, for the terminator.
+    char* Input;
+    int_size InputLength;
+    int_size InputCapacity;
+
+    // Replies the socket couldn't take yet. Nothing more is read from the
+    // connection until they have been sent.
+    char* Pending;
+    int_size PendingStart;
+    int_size PendingLength;
+    int_size PendingCapacity;
+
+    b32 SkippingLine; // The line was too long, so the rest of it is thrown away
+    b32 Closing;      // Closed as soon as Pending is empty
+};
+
+struct dice_server {
+    s32 ListenFileDescriptor;
+    b32 AcceptPaused; // Out of file descriptors until a connection closes
+
+    random_engine Engine;
+    u64 Seed;
+
+    // Indexed by file descriptor, which the kernel keeps small by reusing them
+    serve_connection** Connections;
+    s32 NumConnectionSlots;
+
+    s32 NumOpen;
+    u64 NumAccepted;
+    u64 NumCommands;
+};
+
+// Every client is a file descriptor, and the usual soft limit of 1024 is too
+// few, so it is raised as far as it goes
+internal void
+RaiseFileLimit() {
+    struct rlimit Limit = {};
+    if(getrlimit(RLIMIT_NOFILE, &Limit) == 0 && Limit.rlim_cur < Limit.rlim_max) {
+        Limit.rlim_cur = Limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &Limit);
+    }
+}
+
+// Returns false if the path doesn't fit
+internal b32
+SocketAddress(char const* SocketPath, struct sockaddr_un* Address) {
+    *Address = {};
+    Address->sun_family = AF_UNIX;
+
+    int_size Length = strlen(SocketPath);
+    b32 Result = (Length < (int_size)sizeof(Address->sun_path));
+    if(Result) {
+        memcpy(Address->sun_path, SocketPath, Length + 1);
+    }
+    return Result;
+}
+
+// Blocking connect. Returns -1 if nothing is listening there.
+internal s32
+ConnectToSocket(struct sockaddr_un* Address) {
+    s32 Result = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(Result >= 0 && connect(Result, (struct sockaddr*)Address, sizeof(*Address)) != 0) {
+        close(Result);
+        Result = -1;
+    }
+    return Result;
+}
+
+// --- Server connections
+
+internal void
+CloseConnection(dice_server* Server, serve_connection* Connection) {
+    UnRegisterFDForEPoll(Connection->FileDescriptor);
+    close(Connection->FileDescriptor);
+    Server->Connections[Connection->FileDescriptor] = NULL;
+    Server->NumOpen -= 1;
+
+    DeallocateHeap(Connection->Input);
+    DeallocateHeap(Connection->Pending);
+    DeallocateHeap(Connection);
+
+    if(Server->AcceptPaused) {
+        // There's a file descriptor free again
+        Server->AcceptPaused = false;
+        ChangeEPollEvents(Server->ListenFileDescriptor, EPOLLIN);
+    }
+}
+
+// Returns how much the socket took. A connection that can't be written to any
+// more is marked for closing and everything it was owed is dropped.
+internal int_size
+SendSome(serve_connection* Connection, char const* Bytes, int_size Length) {
+    int_size Result = 0;
+    while(Result < Length) {
+        ssize_t Sent = send(Connection->FileDescriptor, Bytes + Result, Length - Result, MSG_NOSIGNAL);
+        if(Sent < 0) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                Connection->Closing = true;
+                Connection->PendingLength = 0;
+                Result = Length;
+            } else if(errno != EINTR) {
+                break;
+            }
+        } else {
+            Result += Sent;
+        }
+    }
+    return Result;
+}
+
+// Sends what the socket takes now and keeps the rest until it's ready for more
+internal void
+SendToConnection(serve_connection* Connection, char const* Bytes, int_size Length) {
+    if(Connection->PendingLength == 0) {
+        int_size Sent = SendSome(Connection, Bytes, Length);
+        Bytes += Sent;
+        Length -= Sent;
+    }
+
+    if(Length > 0) {
+        if(Connection->PendingStart + Connection->PendingLength + Length > Connection->PendingCapacity) {
+            memmove(Connection->Pending, Connection->Pending + Connection->PendingStart, Connection->PendingLength);
+            Connection->PendingStart = 0;
+
+            int_size Needed = Connection->PendingLength + Length;
+            if(Needed > Connection->PendingCapacity) {
+                int_size NewCapacity = Connection->PendingCapacity > 0 ? 2 * Connection->PendingCapacity : ServeInitialInputSize;
+                while(NewCapacity < Needed) {
+                    NewCapacity *= 2;
+                }
+                Connection->Pending = (char*)ReallocateOnHeap(Connection->Pending, NewCapacity);
+                Connection->PendingCapacity = NewCapacity;
+            }
+        }
+
+        if(Connection->PendingLength == 0) {
+            // Stop reading and wait for room instead
+            ChangeEPollEvents(Connection->FileDescriptor, EPOLLOUT);
+        }
+        memcpy(Connection->Pending + Connection->PendingStart + Connection->PendingLength, Bytes, Length);
+        Connection->PendingLength += Length;
+    }
+}
+
+internal void
+SendPending(serve_connection* Connection) {
+    int_size Sent = SendSome(Connection, Connection->Pending + Connection->PendingStart, Connection->PendingLength);
+    if(Connection->PendingLength > 0) {
+        Connection->PendingStart += Sent;
+        Connection->PendingLength -= Sent;
+    }
+
+    if(Connection->PendingLength == 0) {
+        Connection->PendingStart = 0;
+        if(!Connection->Closing) {
+            ChangeEPollEvents(Connection->FileDescriptor, EPOLLIN);
+        }
+    }
+}
+
+// Sends everything the commands printed, with the \r taken out
+internal void
+SendOutput(serve_connection* Connection) {
+    RemoveCarriageReturns(&Output);
+    SendToConnection(Connection, Output.Contents, Output.Length);
+    Output.Length = 0;
+}
+
+// Runs every whole line that has come in and sends all the replies together.
+// At the end of the input, whatever is left counts as a line too.
+internal void
+RunConnectionCommands(dice_server* Server, serve_connection* Connection, memory_arena* Arena, b32 AtEndOfInput) {
+    char* Start = Connection->Input;
+    char* End = Connection->Input + Connection->InputLength;
+
+    if(Connection->SkippingLine) {
+        char* LineEnd = (char*)memchr(Start, '\n', End - Start);
+        Connection->SkippingLine = (LineEnd == NULL);
+        Start = LineEnd ? LineEnd + 1 : End;
+    }
+
+    while(Start < End && !Connection->Closing) {
+        char* LineEnd = (char*)memchr(Start, '\n', End - Start);
+        if(LineEnd == NULL) {
+            if(!AtEndOfInput) {
+                break;
+            }
+            LineEnd = End;
+        }
+        char* Next = (LineEnd < End) ? LineEnd + 1 : End;
+
+        int_size Length = LineEnd - Start;
+        if(Length > 0 && Start[Length - 1] == '\r') {
+            --Length;
+        }
+        // The tokenizer wants a zero after the command, which goes where the newline was
+        Start[Length] = 0;
+
+        string Command = StringWithLength(Start, Length);
+        b32 KeepOpen = VisitRandomEngine(&Connection->RandomState, [&](auto* EngineState) {
+            return ExecuteCommand(Command, EngineState, Arena);
+        });
+        ResetArena(Arena);
+
+        WriteLiteral(&Output, ".\r\n");
+        Server->NumCommands += 1;
+        if(!KeepOpen) {
+            Connection->Closing = true;
+        }
+
+        Start = Next;
+    }
+
+    // Keep the start of the next line
+    Connection->InputLength = End - Start;
+    memmove(Connection->Input, Start, Connection->InputLength);
+
+    SendOutput(Connection);
+}
+
+internal void
+ReadFromConnection(dice_server* Server, serve_connection* Connection, memory_arena* Arena) {
+    if(Connection->InputLength == Connection->InputCapacity) {
+        // The buffer only fills up with a single unfinished line
+        if(Connection->InputCapacity >= (int_size)ServeMaxLineLength) {
+            WriteLiteral(&Output, "Error: Line too long\r\n.\r\n");
+            SendOutput(Connection);
+            Connection->SkippingLine = true;
+            Connection->InputLength = 0;
+        } else {
+            Connection->InputCapacity *= 2;
+            Connection->Input = (char*)ReallocateOnHeap(Connection->Input, Connection->InputCapacity + 1);
+        }
+    }
+
+    ssize_t NumRead = read(Connection->FileDescriptor, Connection->Input + Connection->InputLength,
+                           Connection->InputCapacity - Connection->InputLength);
+    if(NumRead > 0) {
+        Connection->InputLength += NumRead;
+        RunConnectionCommands(Server, Connection, Arena, false);
+    } else if(NumRead == 0) {
+        // The client is done sending, so answer what's left and close
+        RunConnectionCommands(Server, Connection, Arena, true);
+        Connection->Closing = true;
+    } else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        Connection->Closing = true;
+        Connection->PendingLength = 0;
+    }
+}
+
+internal void
+AcceptConnections(dice_server* Server) {
+    for(;;) {
+        s32 FileDescriptor = accept4(Server->ListenFileDescriptor, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(FileDescriptor < 0) {
+            if(errno == EMFILE || errno == ENFILE) {
+                // Wait for a connection to close instead of being woken up
+                // for the same waiting client over and over
+                Server->AcceptPaused = true;
+                ChangeEPollEvents(Server->ListenFileDescriptor, 0);
+            }
+            break;
+        }
+
+        if(FileDescriptor >= Server->NumConnectionSlots) {
+            s32 NewNumSlots = Server->NumConnectionSlots > 0 ? 2 * Server->NumConnectionSlots : 64;
+            while(NewNumSlots <= FileDescriptor) {
+                NewNumSlots *= 2;
+            }
+            Server->Connections = (serve_connection**)ReallocateOnHeap(Server->Connections, NewNumSlots * sizeof(serve_connection*));
+            ClearBytes(Server->Connections + Server->NumConnectionSlots, (NewNumSlots - Server->NumConnectionSlots) * sizeof(serve_connection*));
+            Server->NumConnectionSlots = NewNumSlots;
+        }
+
+        serve_connection* Connection = AllocateOnHeapTyped<serve_connection>();
+        *Connection = {};
+        Connection->FileDescriptor = FileDescriptor;
+        Connection->InputCapacity = ServeInitialInputSize;
+        Connection->Input = AllocateOnHeapTyped<char>(Connection->InputCapacity + 1);
+
+        // The Nth value of SplitMix64 started from the seed
+        u64 SeedState = Server->Seed + Server->NumAccepted * 0x9E3779B97F4A7C15ULL;
+        SeedRandomEngine(&Connection->RandomState, Server->Engine, SplitMix64(&SeedState));
+
+        Server->Connections[FileDescriptor] = Connection;
+        Server->NumOpen += 1;
+        Server->NumAccepted += 1;
+        RegisterFDForEPollRead(FileDescriptor);
+    }
+}
+
+// Serves until SIGINT or SIGTERM. Arena is reset after every command.
+internal s32
+RunServer(char const* SocketPath, random_engine Engine, u64 Seed, memory_arena* Arena) {
+    struct sockaddr_un Address;
+    if(!SocketAddress(SocketPath, &Address)) {
+        fprintf(stderr, "Error: Socket path '%s' is too long\n", SocketPath);
+        return 1;
+    }
+
+    // A socket left behind by a server that didn't get to clean up is
+    // replaced, but not one that a server is still answering on
+    s32 Existing = ConnectToSocket(&Address);
+    if(Existing >= 0) {
+        close(Existing);
+        fprintf(stderr, "Error: Something is already serving on '%s'\n", SocketPath);
+        return 1;
+    }
+    struct stat FileInfo = {};
+    if(stat(SocketPath, &FileInfo) == 0 && S_ISSOCK(FileInfo.st_mode)) {
+        unlink(SocketPath);
+    }
+
+    dice_server Server = {};
+    Server.Engine = Engine;
+    Server.Seed = Seed;
+    Server.ListenFileDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(Server.ListenFileDescriptor < 0 ||
+       bind(Server.ListenFileDescriptor, (struct sockaddr*)&Address, sizeof(Address)) != 0 ||
+       listen(Server.ListenFileDescriptor, SOMAXCONN) != 0) {
+        fprintf(stderr, "Error: Could not listen on '%s': %s\n", SocketPath, strerror(errno));
+        return 1;
+    }
+
+    RaiseFileLimit();
+    InitEPoll();
+    StartSignalHandling();
+    RegisterFDForEPollRead(Server.ListenFileDescriptor);
+
+    // Replies are collected in the output buffer and handed to the connection
+    Output.Grows = true;
+    SimMaxDice = ServeMaxSimDice;
+    DistMaxLength = ServeMaxDistributionLength;
+    DistMaxKeptWork = ServeMaxKeptDistributionWork;
+
+    fprintf(stderr, "Serving on %s (engine %s, seed %llu)\n", SocketPath, RandomEngineNames[Engine], (unsigned long long)Seed);
+
+    b32 IsRunning = true;
+    while(IsRunning) {
+        struct epoll_event Events[ServeEventsPerWait];
+        s32 NumEvents = epoll_wait(EPollFileDescriptor, Events, ArrayLength(Events), -1);
+
+        for(s32 Index = 0; Index < NumEvents; ++Index) {
+            s32 FileDescriptor = Events[Index].data.fd;
+            u32 Flags = Events[Index].events;
+
+            if(FileDescriptor == Server.ListenFileDescriptor) {
+                AcceptConnections(&Server);
+            } else if(FileDescriptor == SignalFileDescriptor) {
+                struct signalfd_siginfo Signals[8];
+                ssize_t NumRead;
+                while((NumRead = read(SignalFileDescriptor, Signals, sizeof(Signals))) > 0) {
+                    for(s32 SignalIndex = 0; SignalIndex < NumRead / (ssize_t)sizeof(Signals[0]); ++SignalIndex) {
+                        u32 Signal = Signals[SignalIndex].ssi_signo;
+                        if(Signal == SIGINT || Signal == SIGTERM) {
+                            IsRunning = false;
+                        }
+                    }
+                }
+            } else if(FileDescriptor < Server.NumConnectionSlots && Server.Connections[FileDescriptor]) {
+                serve_connection* Connection = Server.Connections[FileDescriptor];
+                if(Connection->PendingLength > 0) {
+                    SendPending(Connection);
+                } else if(Flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    ReadFromConnection(&Server, Connection, Arena);
+                }
+
+                if(Connection->Closing && Connection->PendingLength == 0) {
+                    CloseConnection(&Server, Connection);
+                }
+            }
+        }
+    }
+
+    close(Server.ListenFileDescriptor);
+    unlink(SocketPath);
+    fprintf(stderr, "Served %llu connections and %llu commands\n",
+            (unsigned long long)Server.NumAccepted, (unsigned long long)Server.NumCommands);
+    return 0;
+}
+
+// --- Load generator
+
+// Gone through in turn by every client, each starting at a different one
+global char const* const LoadCommands[] = {
+    "d20",
+    "4d6kh3",
+    "2d20kh1 + 7 >= 15",
+    "8d6",
+    "3d6 + 1d4 - 2",
+};
+
+struct load_client {
+    s32 FileDescriptor;
+    s32 NumSent;
+    u64 SentAt;
+
+    // Looking for the "." line that ends a reply, which may come in pieces
+    b32 AtLineStart;
+    b32 OnDotLine;
+};
+
+internal u64
+MonotonicNanoseconds() {
+    struct timespec Now = {};
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    u64 Result = (u64)Now.tv_sec * 1000000000ULL + (u64)Now.tv_nsec;
+    return Result;
+}
+
+// Returns false if the server is gone
+internal b32
+SendLoadCommand(load_client* Client, s32 ClientIndex) {
+    char const* Command = LoadCommands[(ClientIndex + Client->NumSent) % ArrayLength(LoadCommands)];
+    char Line[64];
+    int_size Length = snprintf(Line, sizeof(Line), "%s\n", Command);
+
+    Client->SentAt = MonotonicNanoseconds();
+    Client->NumSent += 1;
+    Client->AtLineStart = true;
+    Client->OnDotLine = false;
+
+    b32 Result = (send(Client->FileDescriptor, Line, Length, MSG_NOSIGNAL) == Length);
+    return Result;
+}
+
+// Returns true once the reply has ended
+internal b32
+ScanLoadReply(load_client* Client, char const* Bytes, int_size Length) {
+    b32 Result = false;
+    for(int_size Index = 0; Index < Length && !Result; ++Index) {
+        char Char = Bytes[Index];
+        if(Char == '\n') {
+            Result = Client->OnDotLine;
+            Client->AtLineStart = true;
+            Client->OnDotLine = false;
+        } else {
+            Client->OnDotLine = (Client->AtLineStart && Char == '.');
+            Client->AtLineStart = false;
+        }
+    }
+    return Result;
+}
+
+internal r64
+LatencyPercentile(array<s64> Sorted, r64 Fraction) {
+    int_size Index = (int_size)(Fraction * (r64)(Sorted.Length - 1) + 0.5);
+    r64 Result = (r64)Sorted.At(Index) * 1e-3;
+    return Result;
+}
+
+// Opens NumClients connections to the server, has each of them send
+// NumRequests commands one after the other, and prints the throughput and the
+// latency percentiles
+internal s32
+RunLoad(char const* SocketPath, s32 NumClients, s32 NumRequests) {
+    struct sockaddr_un Address;
+    if(!SocketAddress(SocketPath, &Address)) {
+        fprintf(stderr, "Error: Socket path '%s' is too long\n", SocketPath);
+        return 1;
+    }
+    if(NumClients < 1 || NumRequests < 1) {
+        fprintf(stderr, "Error: --clients and --requests must be at least 1\n");
+        return 1;
+    }
+
+    RaiseFileLimit();
+    InitEPoll();
+
+    load_client* Clients = AllocateOnHeapTyped<load_client>(NumClients);
+    ClearBytes(Clients, NumClients * sizeof(load_client));
+
+    s32* ClientByFD = NULL;
+    s32 NumFDSlots = 0;
+
+    for(s32 ClientIndex = 0; ClientIndex < NumClients; ++ClientIndex) {
+        s32 FileDescriptor = ConnectToSocket(&Address);
+        if(FileDescriptor < 0) {
+            fprintf(stderr, "Error: Could not connect to '%s' (client %d): %s\n", SocketPath, ClientIndex, strerror(errno));
+            return 1;
+        }
+        fcntl(FileDescriptor, F_SETFL, fcntl(FileDescriptor, F_GETFL) | O_NONBLOCK);
+
+        if(FileDescriptor >= NumFDSlots) {
+            NumFDSlots = 2 * (FileDescriptor + 1);
+            ClientByFD = (s32*)ReallocateOnHeap(ClientByFD, NumFDSlots * sizeof(s32));
+        }
+        ClientByFD[FileDescriptor] = ClientIndex;
+        Clients[ClientIndex].FileDescriptor = FileDescriptor;
+        RegisterFDForEPollRead(FileDescriptor);
+    }
+
+    // Nanoseconds
+    array<s64> Latencies = {};
+    Latencies.Contents = AllocateOnHeapTyped<s64>((int_size)NumClients * NumRequests);
+
+    // Everyone is connected before the clock starts
+    u64 StartTime = MonotonicNanoseconds();
+    s32 NumActive = 0;
+    for(s32 ClientIndex = 0; ClientIndex < NumClients; ++ClientIndex) {
+        if(SendLoadCommand(&Clients[ClientIndex], ClientIndex)) {
+            NumActive += 1;
+        } else {
+            close(Clients[ClientIndex].FileDescriptor);
+        }
+    }
+
+    s32 NumFailed = NumClients - NumActive;
+    char Buffer[Kilobytes(16)];
+    while(NumActive > 0) {
+        struct epoll_event Events[ServeEventsPerWait];
+        s32 NumEvents = epoll_wait(EPollFileDescriptor, Events, ArrayLength(Events), -1);
+
+        for(s32 Index = 0; Index < NumEvents; ++Index) {
+            s32 ClientIndex = ClientByFD[Events[Index].data.fd];
+            load_client* Client = &Clients[ClientIndex];
+
+            ssize_t NumRead = read(Client->FileDescriptor, Buffer, sizeof(Buffer));
+            b32 IsDone = false;
+            if(NumRead > 0) {
+                if(ScanLoadReply(Client, Buffer, NumRead)) {
+                    Latencies.Contents[Latencies.Length++] = (s64)(MonotonicNanoseconds() - Client->SentAt);
+                    if(Client->NumSent == NumRequests) {
+                        IsDone = true;
+                    } else if(!SendLoadCommand(Client, ClientIndex)) {
+                        IsDone = true;
+                        NumFailed += 1;
+                    }
+                }
+            } else if(NumRead == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // The server closed the connection in the middle of a reply
+                IsDone = true;
+                NumFailed += 1;
+            }
+
+            if(IsDone) {
+                UnRegisterFDForEPoll(Client->FileDescriptor);
+                close(Client->FileDescriptor);
+                NumActive -= 1;
+            }
+        }
+    }
+    r64 Seconds = (r64)(MonotonicNanoseconds() - StartTime) * 1e-9;
+
+    printf("%d clients, %lld replies in %.3fs: %.0f commands/s\n", NumClients, (long long)Latencies.Length,
+           Seconds, (r64)Latencies.Length / Seconds);
+    if(Latencies.Length > 0) {
+        array<s64> Scratch = {};
+        Scratch.Contents = AllocateOnHeapTyped<s64>(Latencies.Length);
+        Scratch.Length = Latencies.Length;
+        RadixSort(Latencies, Scratch, [](s64 Latency) { return Latency; });
+
+        printf("Latency: p50 %.1fus, p90 %.1fus, p99 %.1fus, p99.9 %.1fus, max %.1fus\n",
+               LatencyPercentile(Latencies, 0.5), LatencyPercentile(Latencies, 0.9), LatencyPercentile(Latencies, 0.99),
+               LatencyPercentile(Latencies, 0.999), LatencyPercentile(Latencies, 1.0));
+        DeallocateHeap(Scratch.Contents);
+    }
+    if(NumFailed > 0) {
+        printf("%d clients lost their connection\n", NumFailed);
+    }
+
+    DeallocateHeap(Latencies.Contents);
+    DeallocateHeap(ClientByFD);
+    DeallocateHeap(Clients);
+    return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,364 @@
+/*
+  File: dice-sim.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Monte Carlo simulation of dice expressions across all cores.
+//
+// The samples are cut into chunks and every chunk gets its own split of the
+// random engine, so the numbers a chunk sees don't depend on which thread runs
+// it. Each thread starts with an even share of the chunks and steals half of
+// the largest remaining share when it runs out. Per-chunk results are combined
+// in chunk order at the end, so a given seed always gives the same output.
+// Every chunk keeps its mean and M2 with Welford's update, and those are
+// merged (Chan et al.), so the variance holds up for large totals.
+
+#define SimMaxChunks    4096
+#define SimMinChunkSize 1024
+#define SimMaxBuckets   (1 << 16)
+
+// 0 means one thread per core
+global s32 NumSimThreads;
+
+// Most dice a single 'sim' may roll, counting every die of every sample. 0
+// means no limit. The server sets one, since it answers everyone on one thread.
+global s64 SimMaxDice;
+
+struct sim_chunk_result {
+    s64 Count;
+    r64 Mean;
+    r64 SumSquaredDeviations; // M2, the variance times Count
+    s64 Min;
+    s64 Max;
+    s64 NumSucceeded;
+    b32 DividedByZero;
+};
+
+struct sim_worker {
+    // Chunks this worker still has to do. The next chunk is in the low 32 bits
+    // and one past the last chunk is in the high 32 bits, so both can be
+    // changed together with one compare-and-swap.
+    alignas(64) u64 Range;
+
+    array<u64> Histogram;
+    dice_scratch Scratch;
+    pthread_t Thread;
+    b32 Started; // Thread is running. Worker 0 is the calling thread.
+    void* Job;
+    s32 Index;
+};
+
+template<class random_state>
+struct sim_job {
+    dice_program* Program;
+    s64 NumSamples;
+    s64 ChunkSize;
+    s32 NumChunks;
+
+    random_state* ChunkStates;
+    sim_chunk_result* ChunkResults;
+
+    s64 HistogramMin;
+    s64 BucketWidth;
+    s32 NumBuckets;
+
+    sim_worker* Workers;
+    s32 NumWorkers;
+};
+
+internal inline u64
+PackSimRange(u32 Begin, u32 End) {
+    return ((u64)End << 32) | Begin;
+}
+
+// Takes the next chunk of the worker's own range. Returns -1 if it is empty.
+internal s32
+TakeSimChunk(sim_worker* Worker) {
+    s32 Result = -1;
+    u64 Range = __atomic_load_n(&Worker->Range, __ATOMIC_ACQUIRE);
+    for(;;) {
+        u32 Begin = (u32)Range;
+        u32 End = (u32)(Range >> 32);
+        if(Begin >= End) {
+            break;
+        }
+
+        if(__atomic_compare_exchange_n(&Worker->Range, &Range, PackSimRange(Begin + 1, End), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            Result = (s32)Begin;
+            break;
+        }
+    }
+    return Result;
+}
+
+// Moves the back half of the busiest worker's range to Thief. Returns false once all work is taken.
+internal b32
+StealSimChunks(sim_worker* Workers, s32 NumWorkers, sim_worker* Thief) {
+    b32 Result = false;
+
+    for(;;) {
+        sim_worker* Victim = NULL;
+        u64 VictimRange = 0;
+        u32 MostRemaining = 0;
+
+        for(s32 Index = 0; Index < NumWorkers; ++Index) {
+            u64 Range = __atomic_load_n(&Workers[Index].Range, __ATOMIC_ACQUIRE);
+            u32 Begin = (u32)Range;
+            u32 End = (u32)(Range >> 32);
+            if(Begin < End && End - Begin > MostRemaining) {
+                MostRemaining = End - Begin;
+                Victim = &Workers[Index];
+                VictimRange = Range;
+            }
+        }
+
+        if(!Victim) {
+            break;
+        }
+
+        u32 Begin = (u32)VictimRange;
+        u32 End = (u32)(VictimRange >> 32);
+        u32 Split = End - (End - Begin + 1) / 2;
+        if(__atomic_compare_exchange_n(&Victim->Range, &VictimRange, PackSimRange(Begin, Split), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // Nobody else writes to an empty range, so a plain store is enough
+            __atomic_store_n(&Thief->Range, PackSimRange(Split, End), __ATOMIC_RELEASE);
+            Result = true;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+// Welford's update, so the variance doesn't come from subtracting two huge sums.
+// Result.Min and Max start at INT64_MAX and INT64_MIN.
+internal void
+AddSimSample(sim_chunk_result* Result, s64 Total, b32 Succeeded) {
+    Result->Count += 1;
+    r64 Delta = (r64)Total - Result->Mean;
+    Result->Mean += Delta / (r64)Result->Count;
+    Result->SumSquaredDeviations += Delta * ((r64)Total - Result->Mean);
+    Result->Min = Total < Result->Min ? Total : Result->Min;
+    Result->Max = Total > Result->Max ? Total : Result->Max;
+    Result->NumSucceeded += Succeeded ? 1 : 0;
+}
+
+template<class random_state> internal void
+RunSimChunk(sim_job<random_state>* Job, sim_worker* Worker, s32 ChunkIndex) {
+    random_state RandomState = Job->ChunkStates[ChunkIndex];
+    sim_chunk_result Result = {};
+    Result.Min = INT64_MAX;
+    Result.Max = INT64_MIN;
+
+    s64 FirstSample = (s64)ChunkIndex * Job->ChunkSize;
+    s64 NumSamples = Job->NumSamples - FirstSample;
+    if(NumSamples > Job->ChunkSize) {
+        NumSamples = Job->ChunkSize;
+    }
+
+    u64* Histogram = Worker->Histogram.Contents;
+    for(s64 Sample = 0; Sample < NumSamples; ++Sample) {
+        dice_result Roll = RunDiceProgram<false>(Job->Program, &RandomState, &Worker->Scratch);
+        if(Roll.DividedByZero) {
+            Result.DividedByZero = true;
+            break;
+        }
+
+        AddSimSample(&Result, Roll.Total, Roll.Succeeded);
+        ++Histogram[TotalHistogramBucket(Roll.Total, Job->HistogramMin, Job->BucketWidth, Job->NumBuckets)];
+    }
+
+    Job->ChunkResults[ChunkIndex] = Result;
+}
+
+// Adds Chunk's samples into Total
+internal void
+MergeSimChunk(sim_chunk_result* Total, sim_chunk_result* Chunk) {
+    if(Chunk->Count > 0) {
+        s64 NewCount = Total->Count + Chunk->Count;
+        r64 Delta = Chunk->Mean - Total->Mean;
+        Total->Mean += Delta * (r64)Chunk->Count / (r64)NewCount;
+        Total->SumSquaredDeviations += Chunk->SumSquaredDeviations +
+                                       Delta * Delta * (r64)Total->Count * (r64)Chunk->Count / (r64)NewCount;
+        Total->Count = NewCount;
+    }
+
+    Total->Min = Chunk->Min < Total->Min ? Chunk->Min : Total->Min;
+    Total->Max = Chunk->Max > Total->Max ? Chunk->Max : Total->Max;
+    Total->NumSucceeded += Chunk->NumSucceeded;
+    Total->DividedByZero |= Chunk->DividedByZero;
+}
+
+template<class random_state> internal void*
+SimWorkerProc(void* Data) {
+    sim_worker* Worker = (sim_worker*)Data;
+    sim_job<random_state>* Job = (sim_job<random_state>*)Worker->Job;
+
+    for(;;) {
+        s32 ChunkIndex = TakeSimChunk(Worker);
+        if(ChunkIndex < 0) {
+            if(!StealSimChunks(Job->Workers, Job->NumWorkers, Worker)) {
+                break;
+            }
+        } else {
+            RunSimChunk(Job, Worker, ChunkIndex);
+        }
+    }
+
+    return NULL;
+}
+
+internal r64
+SecondsSince(struct timespec Start) {
+    struct timespec Now = {};
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    r64 Result = (r64)(Now.tv_sec - Start.tv_sec) + (r64)(Now.tv_nsec - Start.tv_nsec) * 1e-9;
+    return Result;
+}
+
+// sim COUNT EXPRESSION (see ParseDiceLine)
+// Uses the engine to seed the simulation and then moves it past everything
+// the simulation used. Working memory comes from Arena.
+template<class random_state> internal void
+ExecuteSimCommand(s64 SampleCount, dice_node* Expression, random_state* RandomState, memory_arena* Arena) {
+    // Compiled once here so the samples only run the program
+    dice_program* Program = PushTyped<dice_program>(Arena);
+    CompileDiceProgram(Expression, Program);
+
+    sim_job<random_state> Job = {};
+    s64 MaxTotal = 0;
+    if(!DiceProgramRange(Program, &Job.HistogramMin, &MaxTotal)) {
+        Print("Error: Totals could be too large to simulate\r\n");
+        return;
+    }
+    SizeTotalHistogram(Job.HistogramMin, MaxTotal, SimMaxBuckets, &Job.BucketWidth, &Job.NumBuckets);
+
+    if(SimMaxDice > 0) {
+        // Rerolls and explosions aren't counted, only the dice each sample starts with
+        s64 DicePerSample = 0;
+        for(s32 Index = 0; Index < Program->NumInstructions; ++Index) {
+            if(Program->Instructions[Index].Opcode == DiceOpRoll) {
+                DicePerSample += Program->Instructions[Index].Dice.Count;
+            }
+        }
+        DicePerSample = DicePerSample > 0 ? DicePerSample : 1;
+        if(SampleCount > SimMaxDice / DicePerSample) {
+            Print("Error: 'sim' can roll at most %lld dice here (%lld samples of this)\r\n",
+                  (long long)SimMaxDice, (long long)(SimMaxDice / DicePerSample));
+            return;
+        }
+    }
+
+    Job.Program = Program;
+    Job.NumSamples = SampleCount;
+    Job.ChunkSize = (Job.NumSamples + SimMaxChunks - 1) / SimMaxChunks;
+    if(Job.ChunkSize < SimMinChunkSize) {
+        Job.ChunkSize = SimMinChunkSize;
+    }
+    Job.NumChunks = (s32)((Job.NumSamples + Job.ChunkSize - 1) / Job.ChunkSize);
+
+    // One extra split becomes the engine's new state
+    Job.ChunkStates = PushTyped<random_state>(Arena, Job.NumChunks + 1);
+    Job.ChunkResults = PushTyped<sim_chunk_result>(Arena, Job.NumChunks);
+    SplitRandom(RandomState, Job.NumChunks + 1, Job.ChunkStates);
+    *RandomState = Job.ChunkStates[Job.NumChunks];
+
+    s32 NumWorkers = NumSimThreads > 0 ? NumSimThreads : (s32)sysconf(_SC_NPROCESSORS_ONLN);
+    if(NumWorkers < 1 || IsSharedRandom(RandomState)) {
+        NumWorkers = 1;
+    }
+    if(NumWorkers > Job.NumChunks) {
+        NumWorkers = Job.NumChunks;
+    }
+
+    Job.NumWorkers = NumWorkers;
+    Job.Workers = PushTyped<sim_worker>(Arena, NumWorkers);
+    for(s32 Index = 0; Index < NumWorkers; ++Index) {
+        sim_worker* Worker = &Job.Workers[Index];
+        *Worker = {};
+        Worker->Index = Index;
+        Worker->Job = &Job;
+        Worker->Histogram = PushArray<u64>(Arena, Job.NumBuckets);
+        Worker->Scratch = PushDiceScratch(Arena, Job.Program);
+        ClearBytes(Worker->Histogram.Contents, Job.NumBuckets * sizeof(u64));
+
+        u32 Begin = (u32)((s64)Job.NumChunks * Index / NumWorkers);
+        u32 End   = (u32)((s64)Job.NumChunks * (Index + 1) / NumWorkers);
+        Worker->Range = PackSimRange(Begin, End);
+    }
+
+    struct timespec StartTime = {};
+    clock_gettime(CLOCK_MONOTONIC, &StartTime);
+
+    // The calling thread is worker 0. The chunks of a worker whose thread
+    // couldn't be started are stolen by the others like any other chunks, so
+    // at worst the calling thread runs all of them.
+    s32 NumThreads = 1;
+    for(s32 Index = 1; Index < NumWorkers; ++Index) {
+        sim_worker* Worker = &Job.Workers[Index];
+        Worker->Started = (pthread_create(&Worker->Thread, NULL, SimWorkerProc<random_state>, Worker) == 0);
+        NumThreads += Worker->Started ? 1 : 0;
+    }
+    SimWorkerProc<random_state>(&Job.Workers[0]);
+    for(s32 Index = 1; Index < NumWorkers; ++Index) {
+        if(Job.Workers[Index].Started) {
+            pthread_join(Job.Workers[Index].Thread, NULL);
+        }
+    }
+
+    r64 Seconds = SecondsSince(StartTime);
+
+    // Merge
+    sim_chunk_result Total = {};
+    Total.Min = INT64_MAX;
+    Total.Max = INT64_MIN;
+    for(s32 Index = 0; Index < Job.NumChunks; ++Index) {
+        MergeSimChunk(&Total, &Job.ChunkResults[Index]);
+    }
+
+    array<u64> Histogram = Job.Workers[0].Histogram;
+    for(s32 Index = 1; Index < NumWorkers; ++Index) {
+        for(s32 Bucket = 0; Bucket < Job.NumBuckets; ++Bucket) {
+            Histogram.Contents[Bucket] += Job.Workers[Index].Histogram.Contents[Bucket];
+        }
+    }
+
+    r64 NumSamples = (r64)Job.NumSamples;
+    r64 Mean = Total.Mean;
+    r64 Variance = Total.SumSquaredDeviations / NumSamples;
+
+    if(Total.DividedByZero) {
+        Print("Error: Divided by zero\r\n");
+    } else {
+        Print("%.*s:\r\n", StringAsArgs(Program->LeftText));
+        Print("  Samples: %lld on %d thread%s in %.3fs (%.0f samples/sec)\r\n",
+              (long long)Job.NumSamples, NumThreads, NumThreads == 1 ? "" : "s", Seconds, NumSamples / Seconds);
+        Print("  Mean: %.3f\r\n"
+              "  Variance: %.3f (std dev %.3f)\r\n"
+              "  Min: %lld\r\n"
+              "  Max: %lld\r\n",
+              Mean, Variance, sqrt(Variance), (long long)Total.Min, (long long)Total.Max);
+
+        r64 Percentiles[] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+        Print("  Percentiles:");
+        s32 Bucket = 0;
+        u64 Cumulative = 0;
+        for(int_size Index = 0; Index < ArrayLength(Percentiles); ++Index) {
+            u64 Needed = (u64)ceil(Percentiles[Index] * NumSamples);
+            while(Bucket < Job.NumBuckets - 1 && Cumulative + Histogram.Contents[Bucket] < Needed) {
+                Cumulative += Histogram.Contents[Bucket];
+                ++Bucket;
+            }
+            Print(" %d%%: %lld", (int)(Percentiles[Index] * 100 + 0.5), (long long)TotalHistogramBucketStart(Bucket, Job.HistogramMin, Job.BucketWidth));
+        }
+        Print("%s\r\n", Job.BucketWidth > 1 ? " (approximate)" : "");
+
+        if(Program->Comparison != TokenTypeNone) {
+            Print("  P(total %s %.*s) = %.4f%%\r\n", ComparisonString(Program->Comparison), StringAsArgs(Program->RightText),
+                  (r64)Total.NumSucceeded / NumSamples * 100);
+        }
+        Print("\r\n");
+    }
+}
@@ -0,0 +1,337 @@
+/*
+  File: dice-watch.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// watch EXPRESSION: takes over the screen and keeps rolling the expression,
+// showing the running statistics and a histogram of the totals next to the
+// exact distribution, until a key is pressed. It rolls for part of every
+// frame and then draws the frame through the screen (screen.cpp), so only
+// the numbers that changed are sent.
+
+#define WatchFrameMS 33
+
+// Rolling stops for the frame after this long, so keys are still read quickly
+#define WatchRollSecondsPerFrame 0.010
+#define WatchRollBatch 256
+
+#define WatchMaxBuckets (1 << 16)
+#define WatchRecentRolls 32
+
+// Rows above the histogram, and below it
+#define WatchHeaderRows 7
+#define WatchFooterRows 2
+
+struct watch_state {
+    dice_program* Program;
+    dice_scratch Scratch;
+
+    // Totals from HistogramMin up, BucketWidth to a bucket
+    u64* Counts;
+    s64 HistogramMin;
+    s64 BucketWidth;
+    s32 NumBuckets;
+
+    // The exact distribution, when it could be worked out
+    b32 HasExpected;
+    distribution Expected;
+    r64 ExpectedMean;
+    r64 ExpectedStdDev;
+    r64 ExpectedSuccess;
+    string ExpectedError;
+
+    sim_chunk_result Stats; // Of every roll so far, kept the same way as sim's
+    s64 NumDividedByZero;
+
+    s64 Recent[WatchRecentRolls]; // Ring, newest at RecentIndex - 1
+    s64 RecentIndex;
+
+    struct timespec StartTime;
+};
+
+template<class random_state> internal void
+RollWatchBatch(watch_state* Watch, random_state* RandomState) {
+    for(s32 Index = 0; Index < WatchRollBatch; ++Index) {
+        dice_result Roll = RunDiceProgram<false>(Watch->Program, RandomState, &Watch->Scratch);
+        if(Roll.DividedByZero) {
+            ++Watch->NumDividedByZero;
+            continue;
+        }
+
+        s64 Total = Roll.Total;
+        AddSimSample(&Watch->Stats, Total, Roll.Succeeded);
+        Watch->Recent[Watch->RecentIndex++ % WatchRecentRolls] = Total;
+
+        ++Watch->Counts[TotalHistogramBucket(Total, Watch->HistogramMin, Watch->BucketWidth, Watch->NumBuckets)];
+    }
+}
+
+// Probability the exact distribution gives to totals in [First, Last]
+internal r64
+ExpectedBetween(watch_state* Watch, s64 First, s64 Last) {
+    r64 Result = 0;
+    distribution* Expected = &Watch->Expected;
+    s64 Start = First - Expected->MinValue;
+    s64 End = Last - Expected->MinValue;
+    for(s64 Index = Start > 0 ? Start : 0; Index <= End && Index < Expected->Probabilities.Length; ++Index) {
+        Result += Expected->Probabilities.Contents[Index];
+    }
+    return Result;
+}
+
+// "First" or "First-Last". Returns the length.
+internal s32
+FormatRowLabel(char* Label, int_size Size, s64 First, s64 Last) {
+    s32 Result = 0;
+    if(Last > First) {
+        Result = snprintf(Label, Size, "%lld-%lld", (long long)First, (long long)Last);
+    } else {
+        Result = snprintf(Label, Size, "%lld", (long long)First);
+    }
+    return Result;
+}
+
+// Totals a row of the histogram covers, worked out from the buckets so the
+// last row of a range reaching INT64_MAX doesn't overflow
+internal void
+WatchRowTotals(watch_state* Watch, s32 FirstBucket, s32 BucketsPerRow, s32 Row, s64* RowFirst, s64* RowLast) {
+    *RowFirst = TotalHistogramBucketStart(FirstBucket + Row * BucketsPerRow, Watch->HistogramMin, Watch->BucketWidth);
+    u64 RowWidth = (u64)BucketsPerRow * (u64)Watch->BucketWidth;
+    u64 Room = (u64)INT64_MAX - (u64)*RowFirst;
+    *RowLast = RowWidth - 1 < Room ? (s64)((u64)*RowFirst + RowWidth - 1) : INT64_MAX;
+}
+
+internal void
+DrawWatchHistogram(screen* Screen, watch_state* Watch) {
+    s32 Top = WatchHeaderRows;
+    s32 NumRows = Screen->Height - WatchHeaderRows - WatchFooterRows;
+    if(NumRows < 1 || Watch->Stats.Count == 0) {
+        return;
+    }
+
+    // Only the totals that have come up get rows, so the histogram fills in as
+    // it runs instead of being squeezed into the whole possible range
+    s32 FirstBucket = TotalHistogramBucket(Watch->Stats.Min, Watch->HistogramMin, Watch->BucketWidth, Watch->NumBuckets);
+    s32 LastBucket = TotalHistogramBucket(Watch->Stats.Max, Watch->HistogramMin, Watch->BucketWidth, Watch->NumBuckets);
+
+    s32 BucketsUsed = LastBucket - FirstBucket + 1;
+    s32 BucketsPerRow = (BucketsUsed + NumRows - 1) / NumRows;
+    NumRows = (BucketsUsed + BucketsPerRow - 1) / BucketsPerRow;
+
+    u64 MostInRow = 1;
+    r64 MostExpected = 0;
+    for(s32 Row = 0; Row < NumRows; ++Row) {
+        u64 InRow = 0;
+        for(s32 Bucket = FirstBucket + Row * BucketsPerRow; Bucket < FirstBucket + (Row + 1) * BucketsPerRow && Bucket <= LastBucket; ++Bucket) {
+            InRow += Watch->Counts[Bucket];
+        }
+        MostInRow = InRow > MostInRow ? InRow : MostInRow;
+
+        if(Watch->HasExpected) {
+            s64 RowFirst, RowLast;
+            WatchRowTotals(Watch, FirstBucket, BucketsPerRow, Row, &RowFirst, &RowLast);
+            r64 Expected = ExpectedBetween(Watch, RowFirst, RowLast);
+            MostExpected = Expected > MostExpected ? Expected : MostExpected;
+        }
+    }
+
+    // Bars are scaled so the longest one, or the longest expected one, fills the space
+    r64 MostFraction = (r64)MostInRow / (r64)Watch->Stats.Count;
+    MostFraction = MostExpected > MostFraction ? MostExpected : MostFraction;
+
+    // The labels are widest at one end or the other
+    char Label[64];
+    s64 RowFirst, RowLast;
+    WatchRowTotals(Watch, FirstBucket, BucketsPerRow, 0, &RowFirst, &RowLast);
+    s32 LabelWidth = FormatRowLabel(Label, sizeof(Label), RowFirst, RowLast);
+    WatchRowTotals(Watch, FirstBucket, BucketsPerRow, NumRows - 1, &RowFirst, &RowLast);
+    s32 LastLabelWidth = FormatRowLabel(Label, sizeof(Label), RowFirst, RowLast);
+    LabelWidth = LastLabelWidth > LabelWidth ? LastLabelWidth : LabelWidth;
+
+    s32 X = DrawFormat(Screen, 2 + LabelWidth, Top - 1, StyleBold, "  %7s", "Seen");
+    if(Watch->HasExpected) {
+        X = DrawFormat(Screen, X, Top - 1, StyleBold, "  %7s", "Exact");
+    }
+    s32 BarX = X + 2;
+    s32 BarWidth = Screen->Width - BarX - 1;
+
+    for(s32 Row = 0; Row < NumRows; ++Row) {
+        s32 Y = Top + Row;
+        WatchRowTotals(Watch, FirstBucket, BucketsPerRow, Row, &RowFirst, &RowLast);
+
+        u64 InRow = 0;
+        for(s32 Bucket = FirstBucket + Row * BucketsPerRow; Bucket < FirstBucket + (Row + 1) * BucketsPerRow && Bucket <= LastBucket; ++Bucket) {
+            InRow += Watch->Counts[Bucket];
+        }
+        r64 Seen = (r64)InRow / (r64)Watch->Stats.Count;
+
+        FormatRowLabel(Label, sizeof(Label), RowFirst, RowLast);
+        X = DrawFormat(Screen, 2, Y, StyleNormal, "%*s  %6.2f%%", LabelWidth, Label, Seen * 100);
+
+        r64 Expected = 0;
+        if(Watch->HasExpected) {
+            Expected = ExpectedBetween(Watch, RowFirst, RowLast);
+            DrawFormat(Screen, X, Y, StyleDim, "  %6.2f%%", Expected * 100);
+        }
+
+        if(BarWidth > 0) {
+            s32 Length = (s32)(Seen / MostFraction * BarWidth + 0.5);
+            FillCells(Screen, BarX, Y, Length, ' ', StyleReverse);
+
+            if(Watch->HasExpected) {
+                // Where the bar should end
+                s32 Mark = (s32)(Expected / MostFraction * BarWidth + 0.5);
+                Mark = Mark > 0 ? Mark - 1 : 0;
+                FillCells(Screen, BarX + Mark, Y, 1, '|', Mark < Length ? (StyleReverse | StyleBold) : StyleBold);
+            }
+        }
+    }
+}
+
+internal void
+DrawWatch(screen* Screen, watch_state* Watch) {
+    ClearScreenBuffer(Screen);
+
+    FillCells(Screen, 0, 0, Screen->Width, ' ', StyleReverse);
+    DrawFormat(Screen, 1, 0, StyleReverse | StyleBold, "watch %.*s", StringAsArgs(Watch->Program->Text));
+    char const Help[] = "Press any key to stop ";
+    DrawText(Screen, Screen->Width - (s32)(ArrayLength(Help) - 1), 0, String(Help), StyleReverse);
+
+    r64 Seconds = SecondsSince(Watch->StartTime);
+    r64 NumRolls = (r64)Watch->Stats.Count;
+    r64 Mean = Watch->Stats.Mean;
+    r64 Variance = NumRolls > 0 ? Watch->Stats.SumSquaredDeviations / NumRolls : 0;
+
+    s32 X = DrawFormat(Screen, 2, 2, StyleNormal, "Rolls: %lld  (%.0f/sec)", (long long)Watch->Stats.Count, Seconds > 0 ? NumRolls / Seconds : 0);
+    if(Watch->Stats.Count > 0) {
+        DrawFormat(Screen, X, 2, StyleNormal, "   Last: %lld", (long long)Watch->Recent[(Watch->RecentIndex - 1) % WatchRecentRolls]);
+    }
+    if(Watch->NumDividedByZero > 0) {
+        DrawFormat(Screen, X + 20, 2, StyleBold, "Divided by zero: %lld", (long long)Watch->NumDividedByZero);
+    }
+
+    X = DrawFormat(Screen, 2, 3, StyleNormal, "Mean: %.3f   Std dev: %.3f", Mean, sqrt(Variance));
+    if(Watch->Stats.Count > 0) {
+        DrawFormat(Screen, X, 3, StyleNormal, "   Min: %lld   Max: %lld", (long long)Watch->Stats.Min, (long long)Watch->Stats.Max);
+    }
+
+    if(Watch->HasExpected) {
+        DrawFormat(Screen, 2, 4, StyleDim, "Expected mean: %.3f   Std dev: %.3f", Watch->ExpectedMean, Watch->ExpectedStdDev);
+    } else {
+        DrawFormat(Screen, 2, 4, StyleDim, "No exact distribution: %.*s", StringAsArgs(Watch->ExpectedError));
+    }
+
+    dice_program* Program = Watch->Program;
+    if(Program->Comparison != TokenTypeNone) {
+        r64 Succeeded = NumRolls > 0 ? (r64)Watch->Stats.NumSucceeded / NumRolls : 0;
+        X = DrawFormat(Screen, 2, 5, StyleNormal, "P(total %s %.*s): %.2f%%", ComparisonString(Program->Comparison),
+                       StringAsArgs(Program->RightText), Succeeded * 100);
+        if(Watch->HasExpected) {
+            DrawFormat(Screen, X, 5, StyleDim, "   Expected: %.2f%%", Watch->ExpectedSuccess * 100);
+        }
+    }
+
+    DrawWatchHistogram(Screen, Watch);
+
+    // Newest first, as many as fit
+    s32 Y = Screen->Height - 1;
+    X = DrawText(Screen, 2, Y, String("Recent:"), StyleDim);
+    s64 NumRecent = Watch->RecentIndex < WatchRecentRolls ? Watch->RecentIndex : WatchRecentRolls;
+    for(s64 Index = 1; Index <= NumRecent && X < Screen->Width; ++Index) {
+        X = DrawFormat(Screen, X, Y, StyleDim, " %lld", (long long)Watch->Recent[(Watch->RecentIndex - Index) % WatchRecentRolls]);
+    }
+
+    PresentScreen(Screen);
+}
+
+// Needs the prompt's input loop (InitVT100UI) for the keys and the frame timer
+template<class random_state> internal void
+ExecuteWatchCommand(dice_node* Expression, random_state* RandomState, memory_arena* Arena) {
+    if(FrameTimerFileDescriptor < 0) {
+        Print("Error: 'watch' only works at the prompt\r\n");
+        return;
+    }
+
+    watch_state* Watch = PushTyped<watch_state>(Arena);
+    *Watch = {};
+    Watch->Program = PushTyped<dice_program>(Arena);
+    CompileDiceProgram(Expression, Watch->Program);
+
+    s64 MaxTotal = 0;
+    if(!DiceProgramRange(Watch->Program, &Watch->HistogramMin, &MaxTotal)) {
+        Print("Error: Totals could be too large to watch\r\n");
+        return;
+    }
+    SizeTotalHistogram(Watch->HistogramMin, MaxTotal, WatchMaxBuckets, &Watch->BucketWidth, &Watch->NumBuckets);
+    Watch->Counts = PushTyped<u64>(Arena, Watch->NumBuckets);
+    Watch->Scratch = PushDiceScratch(Arena, Watch->Program);
+    ClearBytes(Watch->Counts, Watch->NumBuckets * sizeof(u64));
+    Watch->Stats.Min = INT64_MAX;
+    Watch->Stats.Max = INT64_MIN;
+
+    distribution Target = {};
+    Watch->HasExpected = DiceProgramDistribution(Watch->Program, &Watch->Expected, &Target, &Watch->ExpectedError);
+    if(Watch->HasExpected) {
+        Watch->ExpectedMean = DistributionMean(Watch->Expected);
+        Watch->ExpectedStdDev = sqrt(DistributionVariance(Watch->Expected));
+        if(Watch->Program->Comparison != TokenTypeNone) {
+            Watch->ExpectedSuccess = ComparisonProbability(Watch->Expected, Target, Watch->Program->Comparison);
+        }
+    }
+    DeallocateDistribution(&Target);
+
+    screen Screen = {};
+    EnterScreen(&Screen);
+    clock_gettime(CLOCK_MONOTONIC, &Watch->StartTime);
+    DrawWatch(&Screen, Watch);
+    SetFrameTimer(WatchFrameMS);
+
+    b32 Watching = true;
+    while(Watching) {
+        key_event Key = ReadKey();
+        switch(Key.Type) {
+            case KeyFrame: {
+                struct timespec FrameStart = {};
+                clock_gettime(CLOCK_MONOTONIC, &FrameStart);
+                do {
+                    RollWatchBatch(Watch, RandomState);
+                } while(SecondsSince(FrameStart) < WatchRollSecondsPerFrame);
+
+                DrawWatch(&Screen, Watch);
+            } break;
+
+            case KeyWindowResized: {
+                ResizeScreen(&Screen);
+                DrawWatch(&Screen, Watch);
+            } break;
+
+            case KeyMouse: {
+                // Clicks don't count as keys
+            } break;
+
+            case KeyTerminate: {
+                // Left for the prompt, which exits
+                InputDecoder.PendingTerminate = true;
+                Watching = false;
+            } break;
+
+            default: {
+                Watching = false;
+            } break;
+        }
+    }
+
+    SetFrameTimer(0);
+    LeaveScreen(&Screen);
+
+    Print("%.*s: %lld rolls, mean %.3f", StringAsArgs(Watch->Program->LeftText), (long long)Watch->Stats.Count,
+          Watch->Stats.Mean);
+    if(Watch->HasExpected) {
+        Print(" (expected %.3f)", Watch->ExpectedMean);
+    }
+    Print("\r\n\r\n");
+
+    DeallocateDistribution(&Watch->Expected);
+}
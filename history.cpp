@@ -0,0 +1,507 @@
+/*
+  File: history.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Commands typed at the prompt, kept between sessions in a log file with one
+// command per line. New commands are only ever appended to the log. At
+// startup the log is mapped into memory and the entries point straight into
+// the mapping, so nothing is copied or parsed besides finding the line breaks.
+//
+// Running a command again hides the older copy, so going back through the
+// history (or searching it) never shows the same command twice.
+//
+// Ctrl-R searches backwards for a command containing what has been typed.
+// Searches use an index from every 3 characters (trigram) to the entries they
+// appear in, so only entries that have the rarest trigram of the search are
+// looked at. The index is built at the first search and kept up to date after
+// that.
+
+#define HistoryFileName ".dice_history"
+
+#define HistoryInitialSlots 1024
+#define TrigramInitialSlots 1024
+
+struct history_entry {
+    string Text;
+    b32 Hidden; // A later entry has the same text
+};
+
+// From an entry's text to the newest entry with that text
+struct history_slot {
+    u32 Hash;
+    s32 Entry; // -1 if the slot is empty
+};
+
+// Entries with a trigram in them, oldest first
+struct trigram_postings {
+    u32 Trigram; // 0 if the slot is empty, otherwise the 3 bytes plus 1 << 24
+    s32 Count;
+    s32 Capacity;
+    s32* Entries;
+};
+
+struct history {
+    s32 FileDescriptor; // -1 when there is no log, and nothing is saved
+    char* Mapping;
+    int_size MappingSize;
+
+    dynamic_array<history_entry> Entries;
+
+    history_slot* Slots;
+    s32 NumSlots; // Power of 2
+    s32 NumUsedSlots;
+
+    // Trigram index, covering entries up to NumIndexed
+    trigram_postings* Trigrams;
+    s32 NumTrigramSlots; // Power of 2
+    s32 NumTrigrams;
+    s32 NumIndexed;
+};
+
+internal inline u32
+FirstHistorySlot(u32 Hash, u32 Mask) {
+    u32 Result = (Hash ^ (Hash >> 16)) & Mask;
+    return Result;
+}
+
+internal void
+GrowHistorySlots(history* History) {
+    s32 NumSlots = History->NumSlots > 0 ? 2 * History->NumSlots : HistoryInitialSlots;
+    u32 Mask = NumSlots - 1;
+
+    history_slot* Slots = AllocateOnHeapTyped<history_slot>(NumSlots);
+    for(s32 Index = 0; Index < NumSlots; ++Index) {
+        Slots[Index].Entry = -1;
+    }
+    for(s32 Index = 0; Index < History->NumSlots; ++Index) {
+        history_slot Slot = History->Slots[Index];
+        if(Slot.Entry >= 0) {
+            u32 NewIndex = FirstHistorySlot(Slot.Hash, Mask);
+            while(Slots[NewIndex].Entry >= 0) {
+                NewIndex = (NewIndex + 1) & Mask;
+            }
+            Slots[NewIndex] = Slot;
+        }
+    }
+
+    DeallocateHeap(History->Slots);
+    History->Slots = Slots;
+    History->NumSlots = NumSlots;
+}
+
+// Adds an entry that is already in the log (or the mapping), hiding any older
+// entry with the same text
+internal void
+AddHistoryEntry(history* History, string Text) {
+    if(2 * (History->NumUsedSlots + 1) > History->NumSlots) {
+        GrowHistorySlots(History);
+    }
+
+    s32 Entry = (s32)History->Entries.Length;
+    history_entry NewEntry = {};
+    NewEntry.Text = Text;
+    Append(&History->Entries, NewEntry);
+
+    u32 Hash = HashName(Text.Contents, Text.Length, 0);
+    u32 Mask = History->NumSlots - 1;
+    for(u32 Index = FirstHistorySlot(Hash, Mask);; Index = (Index + 1) & Mask) {
+        history_slot* Slot = &History->Slots[Index];
+        if(Slot->Entry < 0) {
+            Slot->Hash = Hash;
+            Slot->Entry = Entry;
+            ++History->NumUsedSlots;
+            break;
+        } else if(Slot->Hash == Hash && StringsEqual(History->Entries.At(Slot->Entry).Text, Text)) {
+            History->Entries.At(Slot->Entry).Hidden = true;
+            Slot->Entry = Entry;
+            break;
+        }
+    }
+}
+
+// Uses $DICE_HISTORY as the log if it is set, or ~/.dice_history. The history
+// still works for the session if the log can't be opened.
+internal void
+LoadHistory(history* History) {
+    *History = {};
+    History->FileDescriptor = -1;
+
+    char Path[4096];
+    char const* Override = getenv("DICE_HISTORY");
+    char const* Home = getenv("HOME");
+    if(Override && Override[0]) {
+        snprintf(Path, sizeof(Path), "%s", Override);
+    } else if(Home && Home[0]) {
+        snprintf(Path, sizeof(Path), "%s/%s", Home, HistoryFileName);
+    } else {
+        return;
+    }
+
+    History->FileDescriptor = open(Path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    struct stat FileInfo = {};
+    if(History->FileDescriptor >= 0 && fstat(History->FileDescriptor, &FileInfo) == 0 && FileInfo.st_size > 0) {
+        void* Mapping = mmap(NULL, FileInfo.st_size, PROT_READ, MAP_PRIVATE, History->FileDescriptor, 0);
+        if(Mapping != MAP_FAILED) {
+            History->Mapping = (char*)Mapping;
+            History->MappingSize = FileInfo.st_size;
+
+            char* At = History->Mapping;
+            char* End = History->Mapping + History->MappingSize;
+            while(At < End) {
+                char* LineEnd = (char*)memchr(At, '\n', End - At);
+                if(LineEnd == NULL) {
+                    // Cut off by a crash part way through a write
+                    break;
+                }
+                if(LineEnd > At) {
+                    AddHistoryEntry(History, StringWithLength(At, LineEnd - At));
+                }
+                At = LineEnd + 1;
+            }
+        }
+    }
+}
+
+// Adds the command to the history and the end of the log. Running the newest
+// command again doesn't add anything.
+internal void
+SaveToHistory(history* History, string Command, memory_arena* Arena) {
+    s64 NumEntries = History->Entries.Length;
+    if(Command.Length == 0 || (NumEntries > 0 && StringsEqual(History->Entries.At(NumEntries - 1).Text, Command))) {
+        return;
+    }
+
+    if(History->FileDescriptor >= 0) {
+        // One write, so the line can't be split up by another session writing to the log
+        char* Line = PushTyped<char>(Arena, Command.Length + 1);
+        memcpy(Line, Command.Contents, Command.Length);
+        Line[Command.Length] = '\n';
+        WriteAll(History->FileDescriptor, Line, Command.Length + 1);
+        AddHistoryEntry(History, StringWithLength(Line, Command.Length));
+    } else {
+        AddHistoryEntry(History, PushString(Arena, Command));
+    }
+}
+
+// The closest entry before Entry that isn't hidden, or -1
+internal s32
+PreviousHistoryEntry(history* History, s32 Entry) {
+    s32 Result = Entry - 1;
+    while(Result >= 0 && History->Entries.At(Result).Hidden) {
+        --Result;
+    }
+    return Result;
+}
+
+// The closest entry after Entry that isn't hidden, or the number of entries
+internal s32
+NextHistoryEntry(history* History, s32 Entry) {
+    s32 Result = Entry + 1;
+    while(Result < History->Entries.Length && History->Entries.At(Result).Hidden) {
+        ++Result;
+    }
+    return Result;
+}
+
+// --- Trigram index
+
+internal inline u32
+TrigramAt(char const* Text) {
+    u32 Result = ((u32)(u8)Text[0] | ((u32)(u8)Text[1] << 8) | ((u32)(u8)Text[2] << 16)) + (1u << 24);
+    return Result;
+}
+
+internal inline u32
+FirstTrigramSlot(u32 Trigram, u32 Mask) {
+    // Fibonacci hashing, since the trigrams themselves are far from random
+    u32 Result = ((Trigram * 2654435769u) >> 8) & Mask;
+    return Result;
+}
+
+// The postings for Trigram, or NULL if no entry has it
+internal trigram_postings*
+FindTrigram(history* History, u32 Trigram) {
+    trigram_postings* Result = NULL;
+    if(History->NumTrigramSlots > 0) {
+        u32 Mask = History->NumTrigramSlots - 1;
+        for(u32 Index = FirstTrigramSlot(Trigram, Mask);; Index = (Index + 1) & Mask) {
+            trigram_postings* Slot = &History->Trigrams[Index];
+            if(Slot->Trigram == Trigram) {
+                Result = Slot;
+                break;
+            } else if(Slot->Trigram == 0) {
+                break;
+            }
+        }
+    }
+    return Result;
+}
+
+internal void
+GrowTrigrams(history* History) {
+    s32 NumSlots = History->NumTrigramSlots > 0 ? 2 * History->NumTrigramSlots : TrigramInitialSlots;
+    u32 Mask = NumSlots - 1;
+
+    trigram_postings* Slots = AllocateOnHeapTyped<trigram_postings>(NumSlots);
+    ClearBytes(Slots, NumSlots * sizeof(trigram_postings));
+    for(s32 Index = 0; Index < History->NumTrigramSlots; ++Index) {
+        trigram_postings* Slot = &History->Trigrams[Index];
+        if(Slot->Trigram != 0) {
+            u32 NewIndex = FirstTrigramSlot(Slot->Trigram, Mask);
+            while(Slots[NewIndex].Trigram != 0) {
+                NewIndex = (NewIndex + 1) & Mask;
+            }
+            Slots[NewIndex] = *Slot;
+        }
+    }
+
+    DeallocateHeap(History->Trigrams);
+    History->Trigrams = Slots;
+    History->NumTrigramSlots = NumSlots;
+}
+
+internal void
+AddTrigram(history* History, u32 Trigram, s32 Entry) {
+    trigram_postings* Postings = FindTrigram(History, Trigram);
+    if(Postings == NULL) {
+        if(2 * (History->NumTrigrams + 1) > History->NumTrigramSlots) {
+            GrowTrigrams(History);
+        }
+
+        u32 Mask = History->NumTrigramSlots - 1;
+        u32 Index = FirstTrigramSlot(Trigram, Mask);
+        while(History->Trigrams[Index].Trigram != 0) {
+            Index = (Index + 1) & Mask;
+        }
+        Postings = &History->Trigrams[Index];
+        Postings->Trigram = Trigram;
+        ++History->NumTrigrams;
+    }
+
+    // Entries are added in order, so a repeat in the same entry is always last
+    if(Postings->Count == 0 || Postings->Entries[Postings->Count - 1] != Entry) {
+        if(Postings->Count == Postings->Capacity) {
+            Postings->Capacity = Postings->Capacity > 0 ? 2 * Postings->Capacity : 4;
+            Postings->Entries = (s32*)ReallocateOnHeap(Postings->Entries, Postings->Capacity * sizeof(s32));
+        }
+        Postings->Entries[Postings->Count++] = Entry;
+    }
+}
+
+// Indexes the entries added since the last search
+internal void
+UpdateTrigramIndex(history* History) {
+    for(s32 Entry = History->NumIndexed; Entry < History->Entries.Length; ++Entry) {
+        string Text = History->Entries.At(Entry).Text;
+        for(int_size Index = 0; Index + 3 <= Text.Length; ++Index) {
+            AddTrigram(History, TrigramAt(Text.Contents + Index), Entry);
+        }
+    }
+    History->NumIndexed = (s32)History->Entries.Length;
+}
+
+internal b32
+HistoryEntryContains(history* History, s32 Entry, string Query, int_size* Offset) {
+    history_entry* Found = &History->Entries.At(Entry);
+    char* Match = NULL;
+    if(!Found->Hidden && Found->Text.Length >= Query.Length) {
+        Match = (char*)memmem(Found->Text.Contents, Found->Text.Length, Query.Contents, Query.Length);
+    }
+
+    b32 Result = (Match != NULL);
+    if(Result) {
+        *Offset = Match - Found->Text.Contents;
+    }
+    return Result;
+}
+
+// The newest entry at or before Start with Query in it, or -1. Offset is where
+// in the entry Query was found.
+internal s32
+SearchHistory(history* History, string Query, s32 Start, int_size* Offset) {
+    s32 Result = -1;
+    if(Start >= History->Entries.Length) {
+        Start = (s32)History->Entries.Length - 1;
+    }
+
+    if(Query.Length < 3) {
+        // Nothing to look up, so every entry is a candidate
+        for(s32 Entry = Start; Entry >= 0 && Result < 0; --Entry) {
+            if(HistoryEntryContains(History, Entry, Query, Offset)) {
+                Result = Entry;
+            }
+        }
+    } else {
+        UpdateTrigramIndex(History);
+
+        // Every match has all of the query's trigrams, so the rarest one
+        // gives the fewest candidates
+        trigram_postings* Rarest = NULL;
+        for(int_size Index = 0; Index + 3 <= Query.Length; ++Index) {
+            trigram_postings* Postings = FindTrigram(History, TrigramAt(Query.Contents + Index));
+            if(Postings == NULL) {
+                Rarest = NULL;
+                break;
+            }
+            if(Rarest == NULL || Postings->Count < Rarest->Count) {
+                Rarest = Postings;
+            }
+        }
+
+        if(Rarest) {
+            // Skip to the candidates at or before Start
+            s32 Low = 0;
+            s32 High = Rarest->Count;
+            while(Low < High) {
+                s32 Middle = Low + (High - Low) / 2;
+                if(Rarest->Entries[Middle] <= Start) {
+                    Low = Middle + 1;
+                } else {
+                    High = Middle;
+                }
+            }
+
+            for(s32 Index = Low - 1; Index >= 0 && Result < 0; --Index) {
+                s32 Entry = Rarest->Entries[Index];
+                if(HistoryEntryContains(History, Entry, Query, Offset)) {
+                    Result = Entry;
+                }
+            }
+        }
+    }
+
+    return Result;
+}
+
+// --- Ctrl-R at the prompt
+
+#define HistorySearchMaxQuery 256
+
+struct history_search {
+    b32 Active;
+    char Query[HistorySearchMaxQuery];
+    int_size QueryLength;
+
+    s32 Match; // -1 if nothing matches
+    int_size MatchOffset;
+
+    // Where the cursor is, counting from the start of the search's first row.
+    // A long match wraps onto the rows under it.
+    int_size CursorColumn;
+
+    // The line from before the search, put back if it is cancelled
+    char* Original;
+    int_size OriginalLength;
+};
+
+// Replaces the prompt's line with the search
+internal void
+DrawHistorySearch(history_search* Search, history* History, s32 ScreenWidth) {
+    MoveCursorInWrappedText(Search->CursorColumn, 0, ScreenWidth);
+    ClearToEndOfScreen();
+
+    string Label = String("(reverse-i-search)`");
+    if(Search->Match < 0 && Search->QueryLength > 0) {
+        Label = String("(failed reverse-i-search)`");
+    }
+    WriteText(&Output, Label);
+    WriteOutput(&Output, Search->Query, Search->QueryLength);
+    WriteLiteral(&Output, "': ");
+    int_size End = Label.Length + Search->QueryLength + 3;
+    Search->CursorColumn = End;
+
+    if(Search->Match >= 0) {
+        string Text = History->Entries.At(Search->Match).Text;
+        WriteText(&Output, Text);
+        Search->CursorColumn = End + Search->MatchOffset;
+        End += Text.Length;
+    }
+
+    FinishWrappedText(End, ScreenWidth);
+    MoveCursorInWrappedText(End, Search->CursorColumn, ScreenWidth);
+}
+
+internal void
+StartHistorySearch(history_search* Search, history* History, line_editor* Editor) {
+    // The search is drawn over the prompt, from the start of its row
+    MoveCursorInWrappedText(LineColumn(Editor, Editor->GapStart), 0, Editor->ScreenWidth);
+    Search->CursorColumn = 0;
+
+    string Line = LineText(Editor);
+    Search->Original = (char*)ReallocateOnHeap(Search->Original, Line.Length + 1);
+    memcpy(Search->Original, Line.Contents, Line.Length);
+    Search->OriginalLength = Line.Length;
+
+    Search->Active = true;
+    Search->QueryLength = 0;
+    Search->Match = -1;
+    DrawHistorySearch(Search, History, Editor->ScreenWidth);
+}
+
+// Puts the prompt back with Text on the line
+internal void
+EndHistorySearch(history_search* Search, line_editor* Editor, char const* Prompt, string Text) {
+    Search->Active = false;
+
+    MoveCursorInWrappedText(Search->CursorColumn, 0, Editor->ScreenWidth);
+    ClearToEndOfScreen();
+    WriteText(&Output, StringFromC(Prompt));
+    ClearLine(Editor);
+    InsertText(Editor, Text.Contents, Text.Length);
+}
+
+// Returns false if the key should also be handled by the prompt as usual, ex.
+// Enter runs the command that was found
+internal b32
+HistorySearchKey(history_search* Search, history* History, line_editor* Editor, char const* Prompt, key_event Key) {
+    b32 Result = true;
+    s32 Char = Key.Char;
+    string Query = StringWithLength(Search->Query, Search->QueryLength);
+
+    if(Key.Type == KeyChar && IsPrintable(Char)) {
+        if(Search->QueryLength < HistorySearchMaxQuery) {
+            Search->Query[Search->QueryLength++] = (char)Char;
+            Query.Length = Search->QueryLength;
+
+            // The match so far might still have the longer query in it
+            s32 Start = Search->Match >= 0 ? Search->Match : (s32)History->Entries.Length - 1;
+            Search->Match = SearchHistory(History, Query, Start, &Search->MatchOffset);
+        }
+        DrawHistorySearch(Search, History, Editor->ScreenWidth);
+    } else if(Key.Type == KeyChar && Char == 127) {
+        // Backspace searches again from the newest entry
+        if(Search->QueryLength > 0) {
+            Query.Length = --Search->QueryLength;
+        }
+        Search->Match = Query.Length > 0 ? SearchHistory(History, Query, (s32)History->Entries.Length - 1, &Search->MatchOffset) : -1;
+        DrawHistorySearch(Search, History, Editor->ScreenWidth);
+    } else if(Key.Type == KeyChar && Char == ('R' - 'A' + 1)) {
+        // The next older match
+        if(Search->Match > 0 && Query.Length > 0) {
+            // If there isn't one the last match stays up
+            s32 Older = SearchHistory(History, Query, Search->Match - 1, &Search->MatchOffset);
+            if(Older >= 0) {
+                Search->Match = Older;
+            }
+        }
+        DrawHistorySearch(Search, History, Editor->ScreenWidth);
+    } else if((Key.Type == KeyChar && (Char == ('G' - 'A' + 1) || Char == ('C' - 'A' + 1))) ||
+              Key.Type == KeyEscape || Key.Type == KeyInterrupt) {
+        EndHistorySearch(Search, Editor, Prompt, StringWithLength(Search->Original, Search->OriginalLength));
+    } else if(Key.Type == KeyMouse || Key.Type == KeyFrame) {
+        // Nothing to do
+    } else {
+        // Anything else takes the match and then does what it normally does
+        string Text = StringWithLength(Search->Original, Search->OriginalLength);
+        if(Search->Match >= 0) {
+            Text = History->Entries.At(Search->Match).Text;
+        }
+        EndHistorySearch(Search, Editor, Prompt, Text);
+        Result = false;
+    }
+
+    return Result;
+}
@@ -0,0 +1,285 @@
+/*
+  File: line-editor.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// The line being typed at the prompt, kept in a gap buffer. The gap sits at
+// the cursor, so typing and deleting there only move the ends of the gap, and
+// moving the cursor only moves the characters it passes over. The buffer
+// doubles when the gap is used up, so there is no limit on the length of a
+// line.
+//
+// Every edit also draws itself, and only draws what changed: inserts and
+// deletes in the middle of the line have the terminal shift the rest of the
+// line over (ICH and DCH) instead of writing it out again. ICH and DCH only
+// shift within a row, so once the prompt and the line are wider than the
+// terminal, edits write the line out again from where they happened and the
+// cursor is moved across the wrapped rows.
+
+#define LineEditorInitialCapacity 256
+
+struct line_editor {
+    char* Contents; // Capacity characters, plus one for a terminator
+    int_size Capacity;
+    int_size GapStart; // Also the cursor
+    int_size GapEnd;
+
+    // The line starts PromptWidth columns into the prompt's row and wraps
+    // every ScreenWidth columns. 0 if the width isn't known, and then the line
+    // is drawn as if it never wraps.
+    s32 PromptWidth;
+    s32 ScreenWidth;
+};
+
+internal inline int_size
+LineLength(line_editor* Editor) {
+    int_size Result = Editor->Capacity - (Editor->GapEnd - Editor->GapStart);
+    return Result;
+}
+
+internal inline int_size
+LengthAfterCursor(line_editor* Editor) {
+    int_size Result = Editor->Capacity - Editor->GapEnd;
+    return Result;
+}
+
+// The column Position on the line is drawn at, counting from the prompt
+internal inline int_size
+LineColumn(line_editor* Editor, int_size Position) {
+    int_size Result = Editor->PromptWidth + Position;
+    return Result;
+}
+
+// Lines that don't reach the last column can be edited with ICH and DCH
+internal inline b32
+LineFitsOnOneRow(line_editor* Editor) {
+    b32 Result = (Editor->ScreenWidth <= 0 || LineColumn(Editor, LineLength(Editor)) < Editor->ScreenWidth);
+    return Result;
+}
+
+// The character at Index as if there were no gap
+internal inline char
+LineCharAt(line_editor* Editor, int_size Index) {
+    char Result = (Index < Editor->GapStart) ? Editor->Contents[Index] : Editor->Contents[Index + (Editor->GapEnd - Editor->GapStart)];
+    return Result;
+}
+
+internal void
+ClearLine(line_editor* Editor) {
+    Editor->GapStart = 0;
+    Editor->GapEnd = Editor->Capacity;
+}
+
+internal void
+InitLineEditor(line_editor* Editor) {
+    Editor->Capacity = LineEditorInitialCapacity;
+    Editor->Contents = AllocateOnHeapTyped<char>(Editor->Capacity + 1);
+    ClearLine(Editor);
+}
+
+// Makes sure the gap has room for Length more characters
+internal void
+ReserveGap(line_editor* Editor, int_size Length) {
+    int_size GapLength = Editor->GapEnd - Editor->GapStart;
+    if(GapLength < Length) {
+        int_size NewCapacity = 2 * Editor->Capacity;
+        while(NewCapacity - LineLength(Editor) < Length) {
+            NewCapacity *= 2;
+        }
+
+        int_size TailLength = LengthAfterCursor(Editor);
+        Editor->Contents = (char*)ReallocateOnHeap(Editor->Contents, NewCapacity + 1);
+        memmove(Editor->Contents + NewCapacity - TailLength, Editor->Contents + Editor->GapEnd, TailLength);
+        Editor->GapEnd = NewCapacity - TailLength;
+        Editor->Capacity = NewCapacity;
+    }
+}
+
+// Moves the gap without drawing anything
+internal void
+MoveGapTo(line_editor* Editor, int_size Position) {
+    if(Position < Editor->GapStart) {
+        int_size Count = Editor->GapStart - Position;
+        Editor->GapStart -= Count;
+        Editor->GapEnd -= Count;
+        memmove(Editor->Contents + Editor->GapEnd, Editor->Contents + Editor->GapStart, Count);
+    } else if(Position > Editor->GapStart) {
+        int_size Count = Position - Editor->GapStart;
+        memmove(Editor->Contents + Editor->GapStart, Editor->Contents + Editor->GapEnd, Count);
+        Editor->GapStart += Count;
+        Editor->GapEnd += Count;
+    }
+}
+
+// The whole line in one piece, with a terminator after it. The gap is moved to
+// the end to make that happen, so this is only worth doing once the line is
+// finished. Good until the next edit.
+internal string
+LineText(line_editor* Editor) {
+    int_size Length = LineLength(Editor);
+    MoveGapTo(Editor, Length);
+    Editor->Contents[Length] = 0;
+    string Result = StringWithLength(Editor->Contents, Length);
+    return Result;
+}
+
+// --- Editing at the cursor
+
+// With the screen's cursor at From, writes the line out from there to the end,
+// clears what was left after it and puts the cursor back at the gap
+internal void
+DrawLineFrom(line_editor* Editor, int_size From) {
+    if(From < Editor->GapStart) {
+        WriteOutput(&Output, Editor->Contents + From, Editor->GapStart - From);
+        WriteOutput(&Output, Editor->Contents + Editor->GapEnd, LengthAfterCursor(Editor));
+    } else {
+        WriteOutput(&Output, Editor->Contents + Editor->GapEnd + (From - Editor->GapStart), LineLength(Editor) - From);
+    }
+
+    int_size End = LineColumn(Editor, LineLength(Editor));
+    if(From < LineLength(Editor)) {
+        FinishWrappedText(End, Editor->ScreenWidth);
+    }
+    ClearToEndOfScreen();
+    MoveCursorInWrappedText(End, LineColumn(Editor, Editor->GapStart), Editor->ScreenWidth);
+}
+
+internal void
+InsertText(line_editor* Editor, char const* Text, int_size Length) {
+    if(Length > 0) {
+        ReserveGap(Editor, Length);
+        memcpy(Editor->Contents + Editor->GapStart, Text, Length);
+        Editor->GapStart += Length;
+
+        if(!LineFitsOnOneRow(Editor)) {
+            DrawLineFrom(Editor, Editor->GapStart - Length);
+        } else {
+            if(LengthAfterCursor(Editor) > 0) {
+                // Make room on the screen for the new characters
+                WriteLiteral(&Output, "\x1b[");
+                WriteInt(&Output, Length);
+                WriteByte(&Output, '@');
+            }
+            WriteOutput(&Output, Text, Length);
+        }
+    }
+}
+
+// Count characters before the cursor
+internal void
+DeleteBackward(line_editor* Editor, int_size Count) {
+    if(Count > Editor->GapStart) {
+        Count = Editor->GapStart;
+    }
+
+    if(Count > 0) {
+        b32 FitsOnOneRow = LineFitsOnOneRow(Editor);
+        MoveCursorInWrappedText(LineColumn(Editor, Editor->GapStart), LineColumn(Editor, Editor->GapStart - Count), Editor->ScreenWidth);
+        Editor->GapStart -= Count;
+        if(!FitsOnOneRow) {
+            DrawLineFrom(Editor, Editor->GapStart);
+        } else if(LengthAfterCursor(Editor) > 0) {
+            WriteLiteral(&Output, "\x1b[");
+            WriteInt(&Output, Count);
+            WriteByte(&Output, 'P');
+        } else {
+            ClearToEndOfLine();
+        }
+    }
+}
+
+// Count characters from the cursor on
+internal void
+DeleteForward(line_editor* Editor, int_size Count) {
+    if(Count > LengthAfterCursor(Editor)) {
+        Count = LengthAfterCursor(Editor);
+    }
+
+    if(Count > 0) {
+        b32 FitsOnOneRow = LineFitsOnOneRow(Editor);
+        Editor->GapEnd += Count;
+        if(!FitsOnOneRow) {
+            DrawLineFrom(Editor, Editor->GapStart);
+        } else {
+            WriteLiteral(&Output, "\x1b[");
+            WriteInt(&Output, Count);
+            WriteByte(&Output, 'P');
+        }
+    }
+}
+
+internal void
+MoveLineCursorTo(line_editor* Editor, int_size Position) {
+    if(Position < 0) {
+        Position = 0;
+    } else if(Position > LineLength(Editor)) {
+        Position = LineLength(Editor);
+    }
+
+    MoveCursorInWrappedText(LineColumn(Editor, Editor->GapStart), LineColumn(Editor, Position), Editor->ScreenWidth);
+    MoveGapTo(Editor, Position);
+}
+
+// Replaces the whole line, ex. with one from the history
+internal void
+SetLineText(line_editor* Editor, string Text) {
+    MoveCursorInWrappedText(LineColumn(Editor, Editor->GapStart), LineColumn(Editor, 0), Editor->ScreenWidth);
+    ClearToEndOfScreen();
+
+    ClearLine(Editor);
+    InsertText(Editor, Text.Contents, Text.Length);
+}
+
+// Writes the line out again after the prompt has been, and puts the cursor back
+internal void
+RedrawLine(line_editor* Editor) {
+    DrawLineFrom(Editor, 0);
+}
+
+// Moves the cursor from the line to the start of the row under it, where
+// whatever is printed next goes. The cursor is left away from the gap, so the
+// line is either finished or drawn again after this.
+internal void
+EndLineOnScreen(line_editor* Editor) {
+    int_size Length = LineLength(Editor);
+    MoveCursorInWrappedText(LineColumn(Editor, Editor->GapStart), LineColumn(Editor, Length), Editor->ScreenWidth);
+
+    // A line that fills its last row already has the cursor on the next one
+    int_size End = LineColumn(Editor, Length);
+    if(Editor->ScreenWidth <= 0 || End % Editor->ScreenWidth != 0) {
+        WriteLiteral(&Output, "\r\n");
+    }
+}
+
+// --- Words
+//
+// A word is a run of anything other than spaces, so 4d6kh3 is one word.
+
+// Where the start of the word before the cursor is
+internal int_size
+PreviousWordStart(line_editor* Editor) {
+    int_size Result = Editor->GapStart;
+    while(Result > 0 && LineCharAt(Editor, Result - 1) == ' ') {
+        --Result;
+    }
+    while(Result > 0 && LineCharAt(Editor, Result - 1) != ' ') {
+        --Result;
+    }
+    return Result;
+}
+
+// Where the end of the word after the cursor is
+internal int_size
+NextWordEnd(line_editor* Editor) {
+    int_size Length = LineLength(Editor);
+    int_size Result = Editor->GapStart;
+    while(Result < Length && LineCharAt(Editor, Result) == ' ') {
+        ++Result;
+    }
+    while(Result < Length && LineCharAt(Editor, Result) != ' ') {
+        ++Result;
+    }
+    return Result;
+}
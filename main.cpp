@@ -12,23 +12,47 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/epoll.h>
+#include <sys/uio.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
 #include <signal.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include "common_defs.h"
 #include "basic_types.h"
 
 #include "common_operations.cpp"
 #include "vt100-ui.cpp"
+#include "line-editor.cpp"
+#include "screen.cpp"
+#include "batch-input.cpp"
+#include "symbols.cpp"
+#include "history.cpp"
 #include "dice-cmd.cpp"
-
-#define USE_STANDARD_C_RNG
 #include "random.cpp"
+#include "dice-roll.cpp"
+#include "dice-dist.cpp"
+#include "dice-sim.cpp"
+#include "dice-watch.cpp"
+#include "dice-serve.cpp"
+#include "rng-quality.cpp"
 
 /*
  * TODO:
@@ -38,14 +62,13 @@
  *  - If the user types something and moves up or down in the line buffer, save the working line into the buffer and copy back when they go past the end of the line buffer
  *  - FIX: After resizing, deleting characters, then pressing enter, it will output 2 lines. The expected output and "Error: Unknown character '"
  *
- *  - advantage, disadvantage, sum/total after dice for advantage, disadvantage, total
+ *  - sum/total after dice for advantage, disadvantage, total
  *  - labels on dice. ex. 2d20:attack, which will use "attack" instead of 2d20 in the result labels
  *  - comparison operators: >, <, >=, <= which just say true/false or succeeded/failed (ex. 2d12 > 7 will compare the total of 2d12 to 7)
  *    Q: What should the precedence be on labels vs. comparison operators?
  *  - Distribution information on dice rolls
  *
  *  Eventually (just for fun)
- *  - Math expressions that include dice. Ex. "2 * (2d20 + 4) - 3d8 > 7 - 3d6"
  *  - Functions like min(), max(), sum() to ensure the desired number is used
  *  - Put distributions in as well to study possible rolls
  */
@@ -53,19 +76,329 @@
 // This will make the program take up the whole screen and restore the contents on exit
 #define RunAsApp 0
 
+// Distributions with at most this many values also print a line per value
+#define DistTableLimit 40
+
+// dist EXPRESSION (see ParseDiceLine)
+internal void
+ExecuteDistCommand(dice_node* Expression, memory_arena* Arena) {
+    dice_program* Program = PushTyped<dice_program>(Arena);
+    CompileDiceProgram(Expression, Program);
+
+    distribution Sum = {};
+    distribution Target = {};
+    string ErrorMessage = {};
+    if(!DiceProgramDistribution(Program, &Sum, &Target, &ErrorMessage)) {
+        Print("Error: %.*s\r\n", StringAsArgs(ErrorMessage));
+    } else {
+        s64 Last = Sum.MinValue + Sum.Probabilities.Length - 1;
+        r64 Variance = DistributionVariance(Sum);
+
+        Print("%.*s:\r\n", StringAsArgs(Program->LeftText));
+        Print("  Range: %lld to %lld\r\n"
+              "  Mean: %.3f\r\n"
+              "  Variance: %.3f (std dev %.3f)\r\n",
+              (long long)Sum.MinValue, (long long)Last,
+              DistributionMean(Sum), Variance, sqrt(Variance));
+
+        r64 Percentiles[] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+        Print("  Percentiles:");
+        for(int_size Index = 0; Index < ArrayLength(Percentiles); ++Index) {
+            Print(" %d%%: %lld", (int)(Percentiles[Index] * 100 + 0.5), (long long)DistributionPercentile(Sum, Percentiles[Index]));
+        }
+        Print("\r\n");
+
+        if(Sum.Probabilities.Length <= DistTableLimit) {
+            for(int_size Index = 0; Index < Sum.Probabilities.Length; ++Index) {
+                s64 Value = Sum.MinValue + Index;
+                Print("  %6lld: %7.3f%%   >= %7.3f%%\r\n", (long long)Value,
+                      Sum.Probabilities.Contents[Index] * 100, ProbabilityAtLeast(Sum, Value) * 100);
+            }
+        }
+
+        if(Program->Comparison != TokenTypeNone) {
+            r64 Probability = ComparisonProbability(Sum, Target, Program->Comparison);
+            Print("  P(total %s %.*s) = %.4f%%\r\n", ComparisonString(Program->Comparison),
+                  StringAsArgs(Program->RightText), Probability * 100);
+        }
+        Print("\r\n");
+    }
+
+    DeallocateDistribution(&Sum);
+    DeallocateDistribution(&Target);
+}
+
+// Rolls a lone set of dice, ex. 3d6, showing every roll
+template<class random_state> internal void
+ExecuteDiceRoll(dice_set Dice, random_state* RandomState) {
+    if(Dice.Count > DicePrintLimit) {
+        // Nobody reads this many rolls, so only sample what gets shown
+        dice_stats Stats = RollDiceStats(RandomState, Dice.Count, Dice.NumSides);
+        Print("(%d rolls not shown)\r\n", Dice.Count);
+        PrintDiceStats(&Stats, Dice.NumSides);
+        WriteLiteral(&Output, "\r\n");
+    } else {
+        s64 Total = 0;
+        s32 Max   = 0;
+        s32 Min   = 0x7FFFFFFF;
+
+        u32 Rolls[DicePrintLimit];
+        RollDice(RandomState, Dice.NumSides, Dice.Count, Rolls);
+
+        for(int_size Index = 0; Index < Dice.Count; ++Index) {
+            s32 Num = Rolls[Index];
+
+            WriteInt(&Output, Num);
+            WriteLiteral(&Output, "  ");
+            Total += Num;
+
+            if(Num > Max) {
+                Max = Num;
+            }
+
+            if(Num < Min) {
+                Min = Num;
+            }
+        }
+
+        WriteLiteral(&Output, "\r\n");
+        if(Dice.Count != 1) {
+            WriteLiteral(&Output, "  Total: ");
+            WriteInt(&Output, Total);
+            WriteLiteral(&Output, "\r\n  Max: ");
+            WriteInt(&Output, Max);
+            WriteLiteral(&Output, "\r\n  Min: ");
+            WriteInt(&Output, Min);
+            WriteLiteral(&Output, "\r\n\r\n");
+        }
+    }
+}
+
+// Rolls an expression with operators, showing the rolls of each set of dice
+template<class random_state> internal void
+ExecuteExpression(dice_node* Expression, random_state* RandomState, memory_arena* Arena) {
+    dice_program* Program = PushTyped<dice_program>(Arena);
+    CompileDiceProgram(Expression, Program);
+
+    s64 MinTotal = 0, MaxTotal = 0;
+    if(!DiceProgramRange(Program, &MinTotal, &MaxTotal)) {
+        Print("Error: Totals could be too large to roll\r\n");
+        return;
+    }
+
+    dice_scratch Scratch = PushDiceScratch(Arena, Program);
+    WriteText(&Output, Program->Text);
+    WriteLiteral(&Output, ":\r\n");
+    dice_result Result = RunDiceProgram<true>(Program, RandomState, &Scratch);
+    if(Result.DividedByZero) {
+        Print("Error: Divided by zero\r\n\r\n");
+    } else if(Program->Comparison != TokenTypeNone) {
+        Print("  Total: %lld %s %lld (%s)\r\n\r\n", (long long)Result.Total, ComparisonString(Program->Comparison),
+              (long long)Result.Target, Result.Succeeded ? "succeeded" : "failed");
+    } else {
+        WriteLiteral(&Output, "  Total: ");
+        WriteInt(&Output, Result.Total);
+        WriteLiteral(&Output, "\r\n\r\n");
+    }
+}
+
+// Everything the command needs is allocated from Arena, which the caller resets afterwards
+template<class random_state> internal b32
+ExecuteCommand(string Command, random_state* RandomState, memory_arena* Arena) {
+    // Returns false if the command asks to quit
+    b32 Result = true;
+
+    // The whole line is parsed first so a mistake anywhere stops all of it
+    dice_line* Line = PushTyped<dice_line>(Arena);
+    ParseDiceLine(Command, Line, Arena);
+
+    if(Line->ErrorMessage.Length > 0) {
+        if(Line->ErrorText.Length > 0) {
+            Print("Error: %.*s at '%.*s'\r\n", StringAsArgs(Line->ErrorMessage), StringAsArgs(Line->ErrorText));
+        } else {
+            Print("Error: %.*s\r\n", StringAsArgs(Line->ErrorMessage));
+        }
+    } else if(Line->Command == DiceCommandQuit) {
+        Result = false;
+    } else if(Line->Command == DiceCommandDist) {
+        ExecuteDistCommand(Line->Items[0].Expression, Arena);
+    } else if(Line->Command == DiceCommandSim) {
+        ExecuteSimCommand(Line->NumSamples, Line->Items[0].Expression, UnpooledRandom(RandomState), Arena);
+    } else if(Line->Command == DiceCommandWatch) {
+        ExecuteWatchCommand(Line->Items[0].Expression, UnpooledRandom(RandomState), Arena);
+    } else {
+        for(s32 ItemIndex = 0; ItemIndex < Line->NumItems; ++ItemIndex) {
+            dice_item* Item = &Line->Items[ItemIndex];
+            if(Item->Type == DiceItemString) {
+                Print("Found string: \"%.*s\"\r\n", StringAsArgs(Item->String));
+            } else if(Item->Expression->Type == DiceNodeDice && IsPlainDice(Item->Expression->Dice)) {
+                ExecuteDiceRoll(Item->Expression->Dice, RandomState);
+            } else if(Item->Expression->Type == DiceNodeNumber) {
+                Print("%lld\r\n", (long long)Item->Expression->Number);
+            } else {
+                ExecuteExpression(Item->Expression, RandomState, Arena);
+            }
+        }
+    }
+
+    return Result;
+}
+
+internal void
+PrintUsage(char const* ProgramName) {
+    fprintf(stderr,
+            "Usage: %s [-f FILE] [--rng ENGINE] [--seed N] [--threads N] [--test-rng [--samples N]]\n"
+            "          [--serve SOCKET] [--load SOCKET [--clients N] [--requests N]]\n"
+            "  -f FILE       Run the commands in FILE, one per line, and exit. '-' reads them\n"
+            "                from stdin, which is also what happens when stdin isn't a terminal.\n"
+            "  --rng ENGINE  Random number engine to roll with: pcg (default), xoshiro, philox, libc\n"
+            "  --seed N      Seed for the engine. Defaults to the current time.\n"
+            "  --threads N   Threads used by 'sim' and '--test-rng'. Defaults to one per core.\n"
+            "  --test-rng    Run statistical tests on the engine picked with --rng, or on all\n"
+            "                of them, then exit. Exits with 1 if any test fails.\n"
+            "  --samples N   Samples per test for --test-rng. Defaults to 100000000.\n"
+            "  --serve SOCKET  Answer commands from clients on a Unix-domain socket until\n"
+            "                SIGINT or SIGTERM. Each reply ends with a line holding only '.'.\n"
+            "  --load SOCKET Send commands to a server from many clients at once and print the\n"
+            "                latency of the replies.\n"
+            "  --clients N   Connections opened by --load. Defaults to 1000.\n"
+            "  --requests N  Commands sent by each --load client, one at a time. Defaults to 100.\n",
+            ProgramName);
+}
+
+global random_pool RandomPool;
+
+// Reset after every command
+global memory_arena CommandArena;
+
+// Lives as long as the program: history and anything else kept between commands
+global memory_arena PermanentArena;
+
+// Runs every line of a script until the end or a quit, without touching the terminal
+internal s32
+RunBatch(char const* Filename, random_engine_state* RandomState) {
+    line_reader Reader = {};
+    if(!OpenLineReader(Filename, &Reader)) {
+        fprintf(stderr, "Error: Could not open '%s'\n", Filename);
+        return 1;
+    }
+
+    Output.StripCarriageReturns = true;
+
+    string Line = {};
+    b32 IsRunning = true;
+    while(IsRunning && ReadLine(&Reader, &Line)) {
+        // The tokenizer wants a zero after the command, which the file doesn't have
+        string Command = PushString(&CommandArena, Line);
+        IsRunning = VisitRandomEngine(RandomState, [&](auto* EngineState) {
+            return ExecuteCommand(Command, EngineState, &CommandArena);
+        });
+        ResetArena(&CommandArena);
+    }
+
+    FlushOutput(&Output);
+    s32 Result = 0;
+    if(Reader.Error) {
+        fprintf(stderr, "Error: Stopped reading '%s': %s\n", Filename, Reader.Error);
+        Result = 1;
+    }
+    CloseLineReader(&Reader);
+    return Result;
+}
+
 static char const Prompt[] = "> ";
-s32 main() {
-    char Buffer[100] = {};
-    standard_c_random_state RandomState = StandardCRNGSeed((u32) time(NULL));
+s32 main(s32 ArgCount, char** Args) {
+    random_engine Engine = RandomEnginePCG;
+    u64 Seed = (u64)time(NULL);
+    b32 EngineWasPicked = false;
+    b32 TestEngines = false;
+    s64 NumTestSamples = 100000000;
+    char const* ScriptFilename = NULL;
+    char const* ServeSocketPath = NULL;
+    char const* LoadSocketPath = NULL;
+    s32 NumLoadClients = 1000;
+    s32 NumLoadRequests = 100;
+
+    for(s32 ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex) {
+        string Arg = StringFromC(Args[ArgIndex]);
+        b32 HasValue = ArgIndex + 1 < ArgCount;
+
+        if(StringsEqual(Arg, String("-f")) && HasValue) {
+            ScriptFilename = Args[++ArgIndex];
+        } else if(StringsEqual(Arg, String("--rng")) && HasValue) {
+            Engine = RandomEngineFromName(Args[++ArgIndex]);
+            if(Engine == RandomEngineCount) {
+                fprintf(stderr, "Error: Unknown random engine '%s'\n", Args[ArgIndex]);
+                PrintUsage(Args[0]);
+                return 1;
+            }
+            EngineWasPicked = true;
+        } else if(StringsEqual(Arg, String("--seed")) && HasValue) {
+            Seed = strtoull(Args[++ArgIndex], NULL, 0);
+        } else if(StringsEqual(Arg, String("--threads")) && HasValue) {
+            NumSimThreads = atoi(Args[++ArgIndex]);
+        } else if(StringsEqual(Arg, String("--test-rng"))) {
+            TestEngines = true;
+        } else if(StringsEqual(Arg, String("--samples")) && HasValue) {
+            NumTestSamples = strtoll(Args[++ArgIndex], NULL, 0);
+        } else if(StringsEqual(Arg, String("--serve")) && HasValue) {
+            ServeSocketPath = Args[++ArgIndex];
+        } else if(StringsEqual(Arg, String("--load")) && HasValue) {
+            LoadSocketPath = Args[++ArgIndex];
+        } else if(StringsEqual(Arg, String("--clients")) && HasValue) {
+            NumLoadClients = atoi(Args[++ArgIndex]);
+        } else if(StringsEqual(Arg, String("--requests")) && HasValue) {
+            NumLoadRequests = atoi(Args[++ArgIndex]);
+        } else {
+            PrintUsage(Args[0]);
+            return 1;
+        }
+    }
+
+    // Before any sim or test threads start rolling
+    InitPCGSIMDLevel();
+
+    random_engine_state RandomState = {};
+    SeedRandomEngine(&RandomState, Engine, Seed);
+
+    if(TestEngines) {
+        s32 NumThreads = NumSimThreads > 0 ? NumSimThreads : (s32)sysconf(_SC_NPROCESSORS_ONLN);
+        s32 NumFailed = RunQualityBattery(&RandomState, !EngineWasPicked, Seed, NumTestSamples, NumThreads);
+        return NumFailed > 0 ? 1 : 0;
+    }
+
+    if(ServeSocketPath) {
+        return RunServer(ServeSocketPath, Engine, Seed, &CommandArena);
+    }
+
+    if(LoadSocketPath) {
+        return RunLoad(LoadSocketPath, NumLoadClients, NumLoadRequests);
+    }
+
+    if(ScriptFilename == NULL && !IsTerminal(STDIN_FILENO)) {
+        ScriptFilename = "-";
+    }
+
+    if(ScriptFilename) {
+        return RunBatch(ScriptFilename, &RandomState);
+    }
+
     InitVT100UI();
 
-    dynamic_array<string> CommandHistory = {};
-    int_size LineBufferPosition = 0;
+    line_editor Editor = {};
+    InitLineEditor(&Editor);
+    Editor.PromptWidth = (s32)StringLength(Prompt);
+    Editor.ScreenWidth = GetWindowSize().X;
+
+    history History = {};
+    LoadHistory(&History);
+    history_search Search = {};
+    s32 HistoryPosition = 0; // The entry on the line, or the number of entries for a new line
     b32 IsRunning = false;
 
     EnableRawMode();
     EnableMouseTracking();
-    // StartResizeHandling();
+    StartSignalHandling();
 
 #if RunAsApp
     SaveScreenState();
@@ -75,243 +408,147 @@ s32 main() {
 
     IsRunning = true;
     while(IsRunning) {
-        printf(Prompt);
-        fflush(stdout);
-
-        int_size BufferIndex  = 0; // The current position in the buffer
-        int_size BufferLength = 0; // The total left of the buffer
-        ClearBytes(Buffer, ArrayLength(Buffer));
-        LineBufferPosition = 0;
+        // Generate ahead of time while the user is typing
+        VisitRandomEngine(&RandomState, [](auto* EngineState) {
+            TopUpRandomPool(&RandomPool, EngineState);
+        });
 
-        for(;;) {
-            s32 Char = ReadChar();
-
-            if(IsPrintable(Char)) {
-                WriteChar(Char);
-                if(BufferLength < StringLength(Buffer)) {
-                    char NextLetter = (char) Char;
-                    int_size StartBufferIndex = BufferIndex;
-                    int_size CurrentIndex = StartBufferIndex;
-                    while(CurrentIndex < StringLength(Buffer) && NextLetter != 0) {
-                        char temp = Buffer[CurrentIndex];
-                        Buffer[CurrentIndex] = NextLetter;
-                        NextLetter = temp;
-                        ++CurrentIndex;
-                    }
+        WriteLiteral(&Output, Prompt);
 
-                    Buffer[CurrentIndex] = '\0';
-                    ++BufferIndex;
-                    ++BufferLength;
+        ClearLine(&Editor);
+        HistoryPosition = (s32)History.Entries.Length;
 
-                    int_size NumCharsLeft = BufferLength - BufferIndex;
-                    write(STDOUT_FILENO, &Buffer[BufferIndex], NumCharsLeft);
-                    MoveCursorByX(-NumCharsLeft);
-                }
-            } else {
-                if(Char == WindowResized) {
-                    printf("Window Resized \r\n");
-                } else if(Char == '\r' || Char == '\n') {
-                    if(BufferLength != 0) {
-                        printf("\r\n");
+        for(;;) {
+            key_event Key = ReadKey();
+            s32 Char = Key.Char;
+            b32 WithControl = (Key.Modifiers & ModifierControl) != 0;
 
-                        string HeapString = CopyOnHeap(StringFromC(Buffer));
-                        Append(&CommandHistory, HeapString);
+            if(Search.Active && HistorySearchKey(&Search, &History, &Editor, Prompt, Key)) {
+                continue;
+            }
 
-                        break;
-                    }
-                } else if(IsControlChar(Char)) {
-                    if(Char == 0x1b) {
-                        // Escape
-                        Char = ReadChar();
-                        if(Char == '[') {
-                            // Arrow keys and maybe other control characters
-                            Char = ReadChar();
-                            if(Char == 'A') {
-                                if(LineBufferPosition >= 0 && LineBufferPosition < CommandHistory.Length) {
-                                    if(LineBufferPosition == 0) {
-                                        // line currently being typed
-                                    }
-
-                                    ++LineBufferPosition;
-                                    string PrevString = CommandHistory.At(CommandHistory.Length - LineBufferPosition);
-                                    CopyInto(PrevString, Buffer);
-
-                                    int_size StartBufferIndex = BufferIndex;
-                                    Buffer[PrevString.Length] = '\0';
-                                    BufferIndex = PrevString.Length;
-                                    BufferLength = PrevString.Length;
-
-                                    // redraw line
-                                    MoveCursorByX(-StartBufferIndex);
-                                    ClearToEndOfLine();
-                                    write(STDOUT_FILENO, Buffer, BufferIndex);
-                                }
-                            } else if(Char == 'B') {
-                                if(LineBufferPosition >= 0 && LineBufferPosition <= CommandHistory.Length) {
-                                    string NextString = {};
-
-                                    if(LineBufferPosition == 0) {
-                                        // TODO: Copy working line into buffer
-                                    } else {
-                                        --LineBufferPosition;
-                                        NextString = CommandHistory.At(CommandHistory.Length - LineBufferPosition);
-                                    }
-
-                                    CopyInto(NextString, Buffer);
-
-                                    int_size StartBufferIndex = BufferIndex;
-                                    Buffer[NextString.Length] = '\0';
-                                    BufferIndex  = NextString.Length;
-                                    BufferLength = NextString.Length;
-
-                                    // redraw line
-                                    MoveCursorByX(-StartBufferIndex);
-                                    ClearToEndOfLine();
-                                    write(STDOUT_FILENO, Buffer, BufferIndex);
-                                }
-                            } else if(Char == 'C') {
-                                if(Buffer[BufferIndex] != 0 && BufferIndex < BufferLength) {
-                                    ++BufferIndex;
-                                    // Move cursor right
-                                    char MoveRight[] = { '\x1b', '[', 'C' };
-                                    write(STDOUT_FILENO, MoveRight, ArrayLength(MoveRight));
-                                }
-                            } else if(Char == 'D') {
-                                if(BufferIndex > 0) {
-                                    --BufferIndex;
-                                    // Move cursor left
-                                    char MoveLeft[] = { '\x1b', '[', 'D' };
-                                    write(STDOUT_FILENO, MoveLeft, ArrayLength(MoveLeft));
-                                }
-                            }
-                        } else {
-                            printf("\r\nUnknown escape sequence: ");
-                            while(read(STDIN_FILENO, &Char, 1) != 0) {
-                                printf("%c", Char);
-                            }
-                            printf("\r\n");
-                        }
-                    } else if(Char >= 0 && Char <= 26) {
-                        // Ctrl-Space (0) and Ctrl-{A through Z} not including J (line-feed) and M (carriage-return)
-                        // char KeyName[] = "space";
-                        // if(Char != 0) {
-                        //     KeyName[0] = Char + 'a' - 1;
-                        //     KeyName[1] = 0;
-                        // }
-                        // printf("\r\nCtrl-%s\r\n", KeyName);
-                        if(Char == ('C' - 'A' + 1)) {
-                            // Ctrl-C
-                            MoveCursorByX(-BufferIndex);
-                            BufferIndex = 0;
-                            BufferLength = 0;
-                            ClearToEndOfLine();
-                            Buffer[BufferIndex] = 0;
-                        } else if(Char == ('D' - 'A' + 1)) {
-                            if(BufferLength == 0) {
-                                exit(0);
-                            }
-                        } else if(Char == ('L' - 'A' + 1)) {
-                            ClearScreen();
-                            MoveCursorToTop();
-
-                            printf("%s%.*s", Prompt, BufferLength, Buffer);
-                            fflush(stdout);
-
-                            MoveCursorByX(BufferIndex - BufferLength);
-                        }
-                    } else if (Char == 127) {
-                        // Backspace
-                        if(BufferIndex > 0) {
-                            MoveCursorByX(-1);
-                            --BufferIndex;
-
-                            for(int_size Index = BufferIndex; Index < BufferLength; ++Index) {
-                                Buffer[Index] = Buffer[Index + 1];
-                            }
-
-                            Buffer[BufferLength] = 0;
-                            --BufferLength;
-
-                            write(STDOUT_FILENO, &Buffer[BufferIndex], BufferLength - BufferIndex);
-                            ClearToEndOfLine();
-                            MoveCursorByX(BufferIndex - BufferLength);
-                        }
+            if(Key.Type == KeyChar && IsPrintable(Char)) {
+                char Letter = (char)Char;
+                InsertText(&Editor, &Letter, 1);
+            } else if(Key.Type == KeyWindowResized) {
+                // A line on one row is still on the cursor's row and is drawn
+                // again in place. The terminal may have rewrapped a longer one,
+                // so that starts over on the next row.
+                s32 ScreenWidth = GetWindowSize().X;
+                if(ScreenWidth != Editor.ScreenWidth) {
+                    if(LineFitsOnOneRow(&Editor)) {
+                        WriteByte(&Output, '\r');
                     } else {
-                        printf("\r\nOther control char [%d]\r\n", Char);
+                        EndLineOnScreen(&Editor);
                     }
+                    Editor.ScreenWidth = ScreenWidth;
+                    WriteLiteral(&Output, Prompt);
+                    RedrawLine(&Editor);
                 }
-            }
-        }
-
-        char* Text = Buffer;
-
-        tokenizer Tokenizer = {};
-        Tokenizer.At = Buffer;
-        Tokenizer.End = Buffer + BufferLength;
-        *(Tokenizer.End) = '\0';
-
-        b32 IsReading = true;
-        while(IsReading) {
-            // TODO: Replace with
-            //   - Read line (expression)
-            //   - Evaluate line (new expression or value structs)
-
-            token CurrentToken = GetToken(&Tokenizer);
-
-            if(CurrentToken.Type == TokenTypeEndOfStream) {
-                IsReading = false;
-            } else if(CurrentToken.Type == TokenTypeDice) {
-                s32 Total = 0;
-                s32 Max   = 0;
-                s32 Min   = 0x7FFFFFFF;
-
-                for(int_size Index = 0; Index < CurrentToken.Dice.Count; ++Index) {
-                    s32 Num = NextRandom(&RandomState) % CurrentToken.Dice.NumSides + 1;
-
-                    printf("%d  ", Num);
-                    Total += Num;
+            } else if(Key.Type == KeyInterrupt) {
+                // Same as Ctrl-C
+                SetLineText(&Editor, {});
+            } else if(Key.Type == KeyTerminate) {
+#if RunAsApp
+                RestoreScreenState();
+#endif
+                FlushOutput(&Output);
+                exit(0);
+            } else if(Key.Type == KeyUp) {
+                s32 Previous = PreviousHistoryEntry(&History, HistoryPosition);
+                if(Previous >= 0) {
+                    HistoryPosition = Previous;
+                    SetLineText(&Editor, History.Entries.At(HistoryPosition).Text);
+                }
+            } else if(Key.Type == KeyDown) {
+                if(HistoryPosition < History.Entries.Length) {
+                    string NextString = {};
 
-                    if(Num > Max) {
-                        Max = Num;
+                    HistoryPosition = NextHistoryEntry(&History, HistoryPosition);
+                    if(HistoryPosition < History.Entries.Length) {
+                        NextString = History.Entries.At(HistoryPosition).Text;
+                    } else {
+                        // TODO: Copy working line into buffer
                     }
 
-                    if(Num < Min) {
-                        Min = Num;
-                    }
+                    SetLineText(&Editor, NextString);
                 }
-
-                printf("\r\n");
-                if(CurrentToken.Dice.Count != 1) {
-                    printf("  Total: %d\r\n"
-                           "  Max: %d\r\n"
-                           "  Min: %d\r\n\r\n",
-                           Total, Max, Min);
+            } else if(Key.Type == KeyRight) {
+                MoveLineCursorTo(&Editor, WithControl ? NextWordEnd(&Editor) : Editor.GapStart + 1);
+            } else if(Key.Type == KeyLeft) {
+                MoveLineCursorTo(&Editor, WithControl ? PreviousWordStart(&Editor) : Editor.GapStart - 1);
+            } else if(Key.Type == KeyHome) {
+                MoveLineCursorTo(&Editor, 0);
+            } else if(Key.Type == KeyEnd) {
+                MoveLineCursorTo(&Editor, LineLength(&Editor));
+            } else if(Key.Type == KeyDelete) {
+                DeleteForward(&Editor, 1);
+            } else if(Key.Type == KeyAlt && (Char == 'b' || Char == 'f')) {
+                // Word movement, as in readline
+                MoveLineCursorTo(&Editor, Char == 'b' ? PreviousWordStart(&Editor) : NextWordEnd(&Editor));
+            } else if(Key.Type == KeyUnknownSequence) {
+                WriteLiteral(&Output, "\r\nUnknown escape sequence: ");
+                WriteText(&Output, StringWithLength(Key.Sequence.Contents + 1, Key.Sequence.Length - 1));
+                WriteLiteral(&Output, "\r\n");
+            } else if(Key.Type != KeyChar) {
+                // Mouse reports and the rest of the keys aren't used at the prompt
+            } else if(Char == '\r' || Char == '\n') {
+                if(LineLength(&Editor) != 0) {
+                    EndLineOnScreen(&Editor);
+
+                    SaveToHistory(&History, LineText(&Editor), &PermanentArena);
+
+                    break;
                 }
-
-            } else if(CurrentToken.Type == TokenTypeIdentifier) {
-                if(StringsEqual(CurrentToken.Identifier, String("quit")) || StringsEqual(CurrentToken.Identifier, String("exit"))) {
-                    IsRunning = false;
-                    IsReading = false;
+            } else if(IsControlChar(Char)) {
+                if(Char >= 0 && Char <= 26) {
+                    // Ctrl-Space (0) and Ctrl-{A through Z} not including J (line-feed) and M (carriage-return)
+                    if(Char == ('A' - 'A' + 1)) {
+                        MoveLineCursorTo(&Editor, 0);
+                    } else if(Char == ('C' - 'A' + 1)) {
+                        SetLineText(&Editor, {});
+                    } else if(Char == ('D' - 'A' + 1)) {
+                        if(LineLength(&Editor) == 0) {
+                            FlushOutput(&Output);
+                            exit(0);
+                        }
+                    } else if(Char == ('E' - 'A' + 1)) {
+                        MoveLineCursorTo(&Editor, LineLength(&Editor));
+                    } else if(Char == ('L' - 'A' + 1)) {
+                        ClearScreen();
+                        MoveCursorToTop();
+
+                        WriteLiteral(&Output, Prompt);
+                        RedrawLine(&Editor);
+                    } else if(Char == ('R' - 'A' + 1)) {
+                        StartHistorySearch(&Search, &History, &Editor);
+                    } else if(Char == ('W' - 'A' + 1)) {
+                        DeleteBackward(&Editor, Editor.GapStart - PreviousWordStart(&Editor));
+                    }
+                } else if (Char == 127) {
+                    // Backspace
+                    DeleteBackward(&Editor, 1);
                 } else {
-                    printf("Error: '%.*s' is not a valid command\r\n", StringAsArgs(CurrentToken.Identifier));
+                    WriteLiteral(&Output, "\r\nOther control char [");
+                    WriteInt(&Output, Char);
+                    WriteLiteral(&Output, "]\r\n");
                 }
-            } else if(CurrentToken.Type == TokenTypeInt) {
-                printf("%d\r\n", CurrentToken.Number);
-            } else if(CurrentToken.Type == TokenTypeString) {
-                printf("Found string: \"%.*s\"\r\n", StringAsArgs(CurrentToken.String));
-            } else if(CurrentToken.Type == TokenTypeError) {
-                printf("Error: %.*s\r\n", StringAsArgs(CurrentToken.ErrorMessage));
-                IsReading = false;
-            } else if(CurrentToken.Type == TokenTypeNone) {
-                printf("Error: Received token type = None\r\n");
-                IsReading = false;
             }
         }
+
+        string Line = LineText(&Editor);
+        IsRunning = VisitRandomEngine(&RandomState, [&](auto* EngineState) {
+            auto PooledState = PooledRandom(&RandomPool, EngineState);
+            return ExecuteCommand(Line, &PooledState, &CommandArena);
+        });
+        // The results go out with the next prompt, in one write
+        ResetArena(&CommandArena);
     }
 
 #if RunAsApp
     RestoreScreenState();
 #endif
+    FlushOutput(&Output);
 
     return 0;
 }
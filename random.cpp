@@ -6,18 +6,16 @@
 
 #include "random.h"
 
-#ifdef USE_STANDARD_C_RNG
 standard_c_random_state StandardCRNGSeed(u32 Seed) {
     srand(Seed);
     standard_c_random_state Result = {};
     return Result;
 }
 
-s32 NextRandom(standard_c_random_state*) {
-    s32 Result = rand();
+u32 NextRandom(standard_c_random_state*) {
+    u32 Result = ((u32)rand() << 16) ^ (u32)rand();
     return Result;
 }
-#endif
 
 // TODO: These rotate functions seem like they're more fit for a numerics library
 #define RotateLeftImpl(type) \
@@ -36,6 +34,25 @@ RotateRightImpl(u32)
 RotateRightImpl(u64)
 #undef RotateRightImpl
 
+internal u64
+SplitMix64(u64* State) {
+    u64 Result = (*State += 0x9E3779B97F4A7C15ULL);
+    Result = (Result ^ (Result >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    Result = (Result ^ (Result >> 27)) * 0x94D049BB133111EBULL;
+    return Result ^ (Result >> 31);
+}
+
+// Mixes every word into one value, which seeds the streams split off from
+// an engine with that state
+internal u64
+HashRandomWords(u64 Hash, u64 const* Words, s32 NumWords) {
+    for(s32 Index = 0; Index < NumWords; ++Index) {
+        Hash ^= Words[Index];
+        Hash = SplitMix64(&Hash);
+    }
+    return Hash;
+}
+
 u32 NextRandom(pcg_random_state* RandomState) {
     u64 OldState = RandomState->State;
     RandomState->State = OldState * 6364136223846793005ULL + (RandomState->Increment | 1);
@@ -58,7 +75,57 @@ pcg_random_state PCGSeed(u64 InitialState, u64 InitialIncrement) {
     return Result;
 }
 
-// Given the state of an RNG returns a number between 0 and 1 (inclusive?)
+// Jumping ahead Delta steps of an LCG is the same as one step with a combined
+// multiplier and increment. Those are built by squaring (Brown, "Random Number
+// Generation with Arbitrary Strides", 1994).
+internal u64
+LCGAdvance(u64 State, u64 Multiplier, u64 Increment, u64 Delta) {
+    u64 AccumulatedMultiplier = 1u;
+    u64 AccumulatedIncrement  = 0u;
+
+    while(Delta > 0) {
+        if(Delta & 1) {
+            AccumulatedMultiplier *= Multiplier;
+            AccumulatedIncrement = AccumulatedIncrement * Multiplier + Increment;
+        }
+        Increment = (Multiplier + 1) * Increment;
+        Multiplier *= Multiplier;
+        Delta >>= 1;
+    }
+
+    u64 Result = AccumulatedMultiplier * State + AccumulatedIncrement;
+    return Result;
+}
+
+void PCGAdvance(pcg_random_state* RandomState, u64 Delta) {
+    RandomState->State = LCGAdvance(RandomState->State, 6364136223846793005ULL, RandomState->Increment | 1, Delta);
+}
+
+void PCGSplit(pcg_random_state Base, s32 NumStreams, u64 StreamLength, pcg_random_state* Streams) {
+    if(StreamLength == 0) {
+        StreamLength = (u64)-1 / (u64)NumStreams;
+    }
+
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = Base;
+        PCGAdvance(&Base, StreamLength);
+    }
+}
+
+// NOTE: Not PCGSplit, which shares out one period between the streams. When
+// the last stream carries on as the engine and is split again, the new
+// streams would come back around onto the old ones. Instead every stream is
+// seeded on its own from a hash of the base, like the lanes in PCGMultiSeed.
+void SplitRandom(pcg_random_state* Base, s32 NumStreams, pcg_random_state* Streams) {
+    u64 Words[] = { Base->State, Base->Increment };
+    u64 SeedState = HashRandomWords(0, Words, ArrayLength(Words));
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = PCGSeed(SplitMix64(&SeedState), SplitMix64(&SeedState));
+    }
+}
+
+// Given the state of an RNG returns a number between 0 and 1. The sum is rounded
+// to float, so 1 itself does come out (about once in 10 million calls, see --test-rng).
 float NextRandom(wichmann_hill_random_state1* State) {
     s32 S1 = (171 * State->S1) % 30269,
         S2 = (172 * State->S2) % 30307,
@@ -67,7 +134,8 @@ float NextRandom(wichmann_hill_random_state1* State) {
     return fmod((float)S1/30269.0 + (float)S2/30307.0 + (float)S3/30323.0, 1.0);
 }
 
-// Given the state of an RNG returns a number between 0 and 1 (inclusive?)
+// Given the state of an RNG returns a number between 0 and 1. The sum is rounded
+// to float, so 1 itself does come out (about once in 10 million calls, see --test-rng).
 float NextRandom(wichmann_hill_random_state2* State) {
     s32 S1 = (11600 * State->S1) % 2147483579,
         S2 = (47003 * State->S2) % 2147483543,
@@ -82,3 +150,533 @@ float NextRandom(wichmann_hill_random_state2* State) {
                          1.0);
     return Result - floor(Result);
 }
+
+// --- Multi-lane PCG
+
+// NOTE: Every path below must give exactly the same output as PCGStepLanesScalar
+#define PCGMultiplier 6364136223846793005ULL
+
+internal void
+PCGStepLanesScalar(pcg_multi_random_state* RandomState, u32* Out) {
+    for(s32 Lane = 0; Lane < PCGLaneCount; ++Lane) {
+        u64 OldState = RandomState->State[Lane];
+        RandomState->State[Lane] = OldState * PCGMultiplier + RandomState->Increment[Lane];
+
+        u32 Result = ((OldState >> 18u) ^ OldState) >> 27u;
+        u32 Rotation = OldState >> 59u;
+        Out[Lane] = RotateRight(Result, Rotation);
+    }
+}
+
+// Writes NumSteps * PCGLaneCount values to Out
+typedef void pcg_fill_lanes(pcg_multi_random_state* RandomState, u32* Out, s64 NumSteps);
+
+internal void
+PCGFillLanesScalar(pcg_multi_random_state* RandomState, u32* Out, s64 NumSteps) {
+    for(s64 Step = 0; Step < NumSteps; ++Step) {
+        PCGStepLanesScalar(RandomState, Out + Step * PCGLaneCount);
+    }
+}
+
+#if defined(__x86_64__)
+
+// SSE2 has no 64-bit multiply, so it is built from 32x32->64 multiplies.
+// Only the low 64 bits of the product are needed.
+internal inline __m128i
+PCGMultiplySSE2(__m128i Value) {
+    __m128i MultiplierLow  = _mm_set1_epi64x(PCGMultiplier & 0xFFFFFFFF);
+    __m128i MultiplierHigh = _mm_set1_epi64x(PCGMultiplier >> 32);
+
+    __m128i Low   = _mm_mul_epu32(Value, MultiplierLow);
+    __m128i Cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(Value, 32), MultiplierLow),
+                                  _mm_mul_epu32(Value, MultiplierHigh));
+    return _mm_add_epi64(Low, _mm_slli_epi64(Cross, 32));
+}
+
+// SSE2 has no per-lane variable shift, so rotate with a 5 stage barrel shifter
+#define RotateStageSSE2(Amount) { \
+        __m128i Bit = _mm_set1_epi32(Amount); \
+        __m128i Mask = _mm_cmpeq_epi32(_mm_and_si128(Rotation, Bit), Bit); \
+        __m128i Rotated = _mm_or_si128(_mm_srli_epi32(Value, Amount), _mm_slli_epi32(Value, 32 - Amount)); \
+        Value = _mm_or_si128(_mm_and_si128(Mask, Rotated), _mm_andnot_si128(Mask, Value)); \
+    }
+
+internal void
+PCGFillLanesSSE2(pcg_multi_random_state* RandomState, u32* Out, s64 NumSteps) {
+    __m128i States[PCGLaneCount / 2];
+    __m128i Increments[PCGLaneCount / 2];
+    for(s32 Index = 0; Index < PCGLaneCount / 2; ++Index) {
+        States[Index]     = _mm_load_si128((__m128i*)RandomState->State + Index);
+        Increments[Index] = _mm_load_si128((__m128i*)RandomState->Increment + Index);
+    }
+
+    for(s64 Step = 0; Step < NumSteps; ++Step) {
+        for(s32 Index = 0; Index < PCGLaneCount / 2; Index += 2) {
+            __m128i Old0 = States[Index];
+            __m128i Old1 = States[Index + 1];
+            States[Index]     = _mm_add_epi64(PCGMultiplySSE2(Old0), Increments[Index]);
+            States[Index + 1] = _mm_add_epi64(PCGMultiplySSE2(Old1), Increments[Index + 1]);
+
+            __m128i Shifted0 = _mm_srli_epi64(_mm_xor_si128(_mm_srli_epi64(Old0, 18), Old0), 27);
+            __m128i Shifted1 = _mm_srli_epi64(_mm_xor_si128(_mm_srli_epi64(Old1, 18), Old1), 27);
+
+            // Gather the low 32 bits of each 64-bit lane, keeping lane order
+            __m128i Value = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(Shifted0), _mm_castsi128_ps(Shifted1), _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i Rotation = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_srli_epi64(Old0, 59)),
+                                                               _mm_castsi128_ps(_mm_srli_epi64(Old1, 59)),
+                                                               _MM_SHUFFLE(2, 0, 2, 0)));
+            RotateStageSSE2(1);
+            RotateStageSSE2(2);
+            RotateStageSSE2(4);
+            RotateStageSSE2(8);
+            RotateStageSSE2(16);
+
+            _mm_storeu_si128((__m128i*)(Out + Step * PCGLaneCount + Index * 2), Value);
+        }
+    }
+
+    for(s32 Index = 0; Index < PCGLaneCount / 2; ++Index) {
+        _mm_store_si128((__m128i*)RandomState->State + Index, States[Index]);
+    }
+}
+
+#undef RotateStageSSE2
+
+__attribute__((target("avx2"))) internal inline __m256i
+PCGMultiplyAVX2(__m256i Value) {
+    __m256i MultiplierLow  = _mm256_set1_epi64x(PCGMultiplier & 0xFFFFFFFF);
+    __m256i MultiplierHigh = _mm256_set1_epi64x(PCGMultiplier >> 32);
+
+    __m256i Low   = _mm256_mul_epu32(Value, MultiplierLow);
+    __m256i Cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(Value, 32), MultiplierLow),
+                                     _mm256_mul_epu32(Value, MultiplierHigh));
+    return _mm256_add_epi64(Low, _mm256_slli_epi64(Cross, 32));
+}
+
+__attribute__((target("avx2"))) internal void
+PCGFillLanesAVX2(pcg_multi_random_state* RandomState, u32* Out, s64 NumSteps) {
+    __m256i States[PCGLaneCount / 4];
+    __m256i Increments[PCGLaneCount / 4];
+    for(s32 Index = 0; Index < PCGLaneCount / 4; ++Index) {
+        States[Index]     = _mm256_load_si256((__m256i*)RandomState->State + Index);
+        Increments[Index] = _mm256_load_si256((__m256i*)RandomState->Increment + Index);
+    }
+
+    __m256i ThirtyTwo = _mm256_set1_epi32(32);
+    for(s64 Step = 0; Step < NumSteps; ++Step) {
+        for(s32 Index = 0; Index < PCGLaneCount / 4; Index += 2) {
+            __m256i Old0 = States[Index];
+            __m256i Old1 = States[Index + 1];
+            States[Index]     = _mm256_add_epi64(PCGMultiplyAVX2(Old0), Increments[Index]);
+            States[Index + 1] = _mm256_add_epi64(PCGMultiplyAVX2(Old1), Increments[Index + 1]);
+
+            __m256i Shifted0 = _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(Old0, 18), Old0), 27);
+            __m256i Shifted1 = _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(Old1, 18), Old1), 27);
+
+            // shuffle_ps works within 128-bit halves, so the permute puts the lanes back in order
+            __m256i Value = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(Shifted0), _mm256_castsi256_ps(Shifted1), _MM_SHUFFLE(2, 0, 2, 0)));
+            Value = _mm256_permute4x64_epi64(Value, _MM_SHUFFLE(3, 1, 2, 0));
+
+            __m256i Rotation = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(_mm256_srli_epi64(Old0, 59)),
+                                                                     _mm256_castsi256_ps(_mm256_srli_epi64(Old1, 59)),
+                                                                     _MM_SHUFFLE(2, 0, 2, 0)));
+            Rotation = _mm256_permute4x64_epi64(Rotation, _MM_SHUFFLE(3, 1, 2, 0));
+
+            // NOTE: A shift by 32 gives 0 with sllv, so a rotation of 0 works without masking
+            Value = _mm256_or_si256(_mm256_srlv_epi32(Value, Rotation), _mm256_sllv_epi32(Value, _mm256_sub_epi32(ThirtyTwo, Rotation)));
+
+            _mm256_storeu_si256((__m256i*)(Out + Step * PCGLaneCount + Index * 4), Value);
+        }
+    }
+
+    for(s32 Index = 0; Index < PCGLaneCount / 4; ++Index) {
+        _mm256_store_si256((__m256i*)RandomState->State + Index, States[Index]);
+    }
+}
+
+// NOTE: _mm512_mullo_epi64 needs AVX-512DQ, so the multiply is built the same way as above to only require AVX-512F
+__attribute__((target("avx512f"))) internal inline __m512i
+PCGMultiplyAVX512(__m512i Value) {
+    __m512i MultiplierLow  = _mm512_set1_epi64(PCGMultiplier & 0xFFFFFFFF);
+    __m512i MultiplierHigh = _mm512_set1_epi64(PCGMultiplier >> 32);
+
+    __m512i Low   = _mm512_mul_epu32(Value, MultiplierLow);
+    __m512i Cross = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(Value, 32), MultiplierLow),
+                                     _mm512_mul_epu32(Value, MultiplierHigh));
+    return _mm512_add_epi64(Low, _mm512_slli_epi64(Cross, 32));
+}
+
+__attribute__((target("avx512f"))) internal void
+PCGFillLanesAVX512(pcg_multi_random_state* RandomState, u32* Out, s64 NumSteps) {
+    __m512i State0 = _mm512_load_si512(RandomState->State);
+    __m512i State1 = _mm512_load_si512(RandomState->State + 8);
+    __m512i Increment0 = _mm512_load_si512(RandomState->Increment);
+    __m512i Increment1 = _mm512_load_si512(RandomState->Increment + 8);
+
+    for(s64 Step = 0; Step < NumSteps; ++Step) {
+        __m512i Old0 = State0;
+        __m512i Old1 = State1;
+        State0 = _mm512_add_epi64(PCGMultiplyAVX512(Old0), Increment0);
+        State1 = _mm512_add_epi64(PCGMultiplyAVX512(Old1), Increment1);
+
+        __m512i Shifted0 = _mm512_srli_epi64(_mm512_xor_si512(_mm512_srli_epi64(Old0, 18), Old0), 27);
+        __m512i Shifted1 = _mm512_srli_epi64(_mm512_xor_si512(_mm512_srli_epi64(Old1, 18), Old1), 27);
+
+        __m512i Value = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(Shifted0)),
+                                           _mm512_cvtepi64_epi32(Shifted1), 1);
+        __m512i Rotation = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtepi64_epi32(_mm512_srli_epi64(Old0, 59))),
+                                              _mm512_cvtepi64_epi32(_mm512_srli_epi64(Old1, 59)), 1);
+
+        _mm512_storeu_si512(Out + Step * PCGLaneCount, _mm512_rorv_epi32(Value, Rotation));
+    }
+
+    _mm512_store_si512(RandomState->State, State0);
+    _mm512_store_si512(RandomState->State + 8, State1);
+}
+
+internal simd_level
+GetCPUSIMDLevel() {
+    simd_level Result = SIMDLevelSSE2; // Always available on x86-64
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) {
+        Result = SIMDLevelAVX512;
+    } else if(__builtin_cpu_supports("avx2")) {
+        Result = SIMDLevelAVX2;
+    }
+    return Result;
+}
+
+#else
+
+internal simd_level
+GetCPUSIMDLevel() {
+    return SIMDLevelScalar;
+}
+
+#endif
+
+// Scalar until InitPCGSIMDLevel or SetPCGSIMDLevel picks something else
+global simd_level PCGSIMDLevel = SIMDLevelScalar;
+global pcg_fill_lanes* PCGFillLanes = PCGFillLanesScalar;
+
+simd_level SetPCGSIMDLevel(simd_level Level) {
+    simd_level CPULevel = GetCPUSIMDLevel();
+    if(Level > CPULevel) {
+        Level = CPULevel;
+    }
+
+    PCGSIMDLevel = Level;
+    switch(Level) {
+#if defined(__x86_64__)
+        case SIMDLevelAVX512: PCGFillLanes = PCGFillLanesAVX512; break;
+        case SIMDLevelAVX2:   PCGFillLanes = PCGFillLanesAVX2;   break;
+        case SIMDLevelSSE2:   PCGFillLanes = PCGFillLanesSSE2;   break;
+#endif
+        default:              PCGFillLanes = PCGFillLanesScalar; break;
+    }
+
+    return Level;
+}
+
+simd_level InitPCGSIMDLevel() {
+    simd_level Level = GetCPUSIMDLevel();
+    if(Level == SIMDLevelSSE2) {
+        // Emulating the 64-bit multiply and the variable rotate costs more
+        // than SSE2 saves, so the scalar lanes are faster there
+        Level = SIMDLevelScalar;
+    }
+    return SetPCGSIMDLevel(Level);
+}
+
+simd_level GetPCGSIMDLevel() {
+    return PCGSIMDLevel;
+}
+
+pcg_multi_random_state PCGMultiSeed(u64 Seed) {
+    pcg_multi_random_state Result = {};
+
+    // NOTE: PCG streams that differ only in their increment and start from
+    // related states give correlated output, which showed up as biased sums of
+    // dice taken from neighbouring lanes. So every lane gets an unrelated state
+    // and increment.
+    u64 SeedState = Seed;
+    for(s32 Lane = 0; Lane < PCGLaneCount; ++Lane) {
+        pcg_random_state LaneState = PCGSeed(SplitMix64(&SeedState), SplitMix64(&SeedState));
+        Result.State[Lane] = LaneState.State;
+        Result.Increment[Lane] = LaneState.Increment | 1;
+    }
+    Result.BufferedIndex = PCGLaneCount;
+
+    return Result;
+}
+
+u32 NextRandom(pcg_multi_random_state* RandomState) {
+    if(RandomState->BufferedIndex == PCGLaneCount) {
+        PCGStepLanesScalar(RandomState, RandomState->Buffered);
+        RandomState->BufferedIndex = 0;
+    }
+
+    u32 Result = RandomState->Buffered[RandomState->BufferedIndex++];
+    return Result;
+}
+
+void FillRandom(u32* Out, s64 Count, pcg_multi_random_state* RandomState) {
+    // Use up whatever is left from the last partial step first so that NextRandom
+    // and FillRandom can be mixed and still walk the same sequence.
+    while(Count > 0 && RandomState->BufferedIndex < PCGLaneCount) {
+        *Out++ = RandomState->Buffered[RandomState->BufferedIndex++];
+        --Count;
+    }
+
+    s64 NumSteps = Count / PCGLaneCount;
+    if(NumSteps > 0) {
+        PCGFillLanes(RandomState, Out, NumSteps);
+        Out   += NumSteps * PCGLaneCount;
+        Count -= NumSteps * PCGLaneCount;
+    }
+
+    while(Count > 0) {
+        *Out++ = NextRandom(RandomState);
+        --Count;
+    }
+}
+
+void PCGAdvance(pcg_multi_random_state* RandomState, u64 Delta) {
+    u64 NumBuffered = PCGLaneCount - RandomState->BufferedIndex;
+    if(Delta <= NumBuffered) {
+        RandomState->BufferedIndex += (s32)Delta;
+    } else {
+        Delta -= NumBuffered;
+        RandomState->BufferedIndex = PCGLaneCount;
+
+        u64 NumSteps = Delta / PCGLaneCount;
+        for(s32 Lane = 0; Lane < PCGLaneCount; ++Lane) {
+            RandomState->State[Lane] = LCGAdvance(RandomState->State[Lane], PCGMultiplier, RandomState->Increment[Lane], NumSteps);
+        }
+
+        s32 Remainder = (s32)(Delta % PCGLaneCount);
+        if(Remainder > 0) {
+            PCGStepLanesScalar(RandomState, RandomState->Buffered);
+            RandomState->BufferedIndex = Remainder;
+        }
+    }
+}
+
+// Seeded on their own for the same reason as SplitRandom(pcg_random_state*)
+void SplitRandom(pcg_multi_random_state* Base, s32 NumStreams, pcg_multi_random_state* Streams) {
+    u64 SeedState = HashRandomWords(0, Base->State, PCGLaneCount);
+    SeedState = HashRandomWords(SeedState, Base->Increment, PCGLaneCount);
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = PCGMultiSeed(SplitMix64(&SeedState));
+    }
+}
+
+void PCGSplit(pcg_multi_random_state const* Base, s32 NumStreams, u64 StreamLength, pcg_multi_random_state* Streams) {
+    if(StreamLength == 0) {
+        StreamLength = (u64)-1 / (u64)NumStreams;
+    }
+
+    pcg_multi_random_state Current = *Base;
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = Current;
+        PCGAdvance(&Current, StreamLength);
+    }
+}
+
+#undef PCGMultiplier
+
+// --- xoshiro256**
+
+xoshiro_random_state XoshiroSeed(u64 Seed) {
+    xoshiro_random_state Result = {};
+    // SplitMix64 never gives an all-zero state from any seed
+    for(s32 Index = 0; Index < 4; ++Index) {
+        Result.S[Index] = SplitMix64(&Seed);
+    }
+    return Result;
+}
+
+u64 NextRandom64(xoshiro_random_state* RandomState) {
+    u64* S = RandomState->S;
+    u64 Result = RotateLeft(S[1] * 5, (u64)7) * 9;
+    u64 Temp = S[1] << 17;
+
+    S[2] ^= S[0];
+    S[3] ^= S[1];
+    S[1] ^= S[2];
+    S[0] ^= S[3];
+
+    S[2] ^= Temp;
+    S[3] = RotateLeft(S[3], (u64)45);
+
+    return Result;
+}
+
+u32 NextRandom(xoshiro_random_state* RandomState) {
+    u32 Result = 0;
+    if(RandomState->HasSpareHalf) {
+        Result = RandomState->SpareHalf;
+        RandomState->HasSpareHalf = false;
+    } else {
+        u64 Value = NextRandom64(RandomState);
+        Result = (u32)Value;
+        RandomState->SpareHalf = (u32)(Value >> 32);
+        RandomState->HasSpareHalf = true;
+    }
+    return Result;
+}
+
+void FillRandom(u32* Out, s64 Count, xoshiro_random_state* RandomState) {
+    if(Count > 0 && RandomState->HasSpareHalf) {
+        *Out++ = NextRandom(RandomState);
+        --Count;
+    }
+
+    for(; Count >= 2; Count -= 2) {
+        u64 Value = NextRandom64(RandomState);
+        *Out++ = (u32)Value;
+        *Out++ = (u32)(Value >> 32);
+    }
+
+    if(Count > 0) {
+        *Out = NextRandom(RandomState);
+    }
+}
+
+void XoshiroJump(xoshiro_random_state* RandomState) {
+    static u64 const Jump[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+
+    u64 S[4] = {};
+    for(s32 JumpIndex = 0; JumpIndex < (s32)ArrayLength(Jump); ++JumpIndex) {
+        for(s32 Bit = 0; Bit < 64; ++Bit) {
+            if(Jump[JumpIndex] & (1ULL << Bit)) {
+                for(s32 Index = 0; Index < 4; ++Index) {
+                    S[Index] ^= RandomState->S[Index];
+                }
+            }
+            NextRandom64(RandomState);
+        }
+    }
+
+    for(s32 Index = 0; Index < 4; ++Index) {
+        RandomState->S[Index] = S[Index];
+    }
+    RandomState->HasSpareHalf = false;
+}
+
+void SplitRandom(xoshiro_random_state* Base, s32 NumStreams, xoshiro_random_state* Streams) {
+    xoshiro_random_state Current = *Base;
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = Current;
+        XoshiroJump(&Current);
+    }
+}
+
+// --- Philox4x32-10
+
+internal void
+PhiloxBlock(u32 const* Key, u64 Stream, u64 BlockIndex, u32* Out) {
+    u32 C0 = (u32)BlockIndex, C1 = (u32)(BlockIndex >> 32), C2 = (u32)Stream, C3 = (u32)(Stream >> 32);
+    u32 K0 = Key[0], K1 = Key[1];
+
+    for(s32 Round = 0; Round < 10; ++Round) {
+        u64 Product0 = (u64)0xD2511F53 * C0;
+        u64 Product1 = (u64)0xCD9E8D57 * C2;
+
+        u32 Next0 = (u32)(Product1 >> 32) ^ C1 ^ K0;
+        u32 Next1 = (u32)Product1;
+        u32 Next2 = (u32)(Product0 >> 32) ^ C3 ^ K1;
+        u32 Next3 = (u32)Product0;
+        C0 = Next0; C1 = Next1; C2 = Next2; C3 = Next3;
+
+        K0 += 0x9E3779B9;
+        K1 += 0xBB67AE85;
+    }
+
+    Out[0] = C0; Out[1] = C1; Out[2] = C2; Out[3] = C3;
+}
+
+philox_random_state PhiloxSeed(u64 Seed) {
+    philox_random_state Result = {};
+    Result.Key[0] = (u32)Seed;
+    Result.Key[1] = (u32)(Seed >> 32);
+    Result.BlockIndex = (u64)-1;
+    return Result;
+}
+
+u32 NextRandom(philox_random_state* RandomState) {
+    u64 BlockIndex = RandomState->Position >> 2;
+    if(BlockIndex != RandomState->BlockIndex) {
+        PhiloxBlock(RandomState->Key, RandomState->Stream, BlockIndex, RandomState->Block);
+        RandomState->BlockIndex = BlockIndex;
+    }
+
+    u32 Result = RandomState->Block[RandomState->Position & 3];
+    RandomState->Position += 1;
+    return Result;
+}
+
+void FillRandom(u32* Out, s64 Count, philox_random_state* RandomState) {
+    while(Count > 0 && (RandomState->Position & 3) != 0) {
+        *Out++ = NextRandom(RandomState);
+        --Count;
+    }
+
+    // Whole blocks go straight to the output
+    for(; Count >= 4; Count -= 4, Out += 4) {
+        PhiloxBlock(RandomState->Key, RandomState->Stream, RandomState->Position >> 2, Out);
+        RandomState->Position += 4;
+    }
+
+    while(Count > 0) {
+        *Out++ = NextRandom(RandomState);
+        --Count;
+    }
+}
+
+// Every stream gets a stream number of its own and starts at position 0. The
+// numbers are a hash of where the base is, so splitting again from any of the
+// streams gives new numbers instead of spreading out over the same 2^64
+// positions again.
+void SplitRandom(philox_random_state* Base, s32 NumStreams, philox_random_state* Streams) {
+    u64 Words[] = { ((u64)Base->Key[1] << 32) | Base->Key[0], Base->Stream, Base->Position };
+    u64 StreamState = HashRandomWords(0, Words, ArrayLength(Words));
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = *Base;
+        Streams[Index].Stream = SplitMix64(&StreamState);
+        Streams[Index].Position = 0;
+        Streams[Index].BlockIndex = (u64)-1;
+    }
+}
+
+void SplitRandom(standard_c_random_state* Base, s32 NumStreams, standard_c_random_state* Streams) {
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = *Base;
+    }
+}
+
+// --- Engine selection
+
+char const* const RandomEngineNames[RandomEngineCount] = {
+    "pcg",
+    "xoshiro",
+    "philox",
+    "libc",
+};
+
+random_engine RandomEngineFromName(char const* Name) {
+    random_engine Result = RandomEngineCount;
+    for(s32 Index = 0; Index < RandomEngineCount; ++Index) {
+        if(StringsEqual(StringFromC(Name), StringFromC(RandomEngineNames[Index]))) {
+            Result = (random_engine)Index;
+            break;
+        }
+    }
+    return Result;
+}
+
+void SeedRandomEngine(random_engine_state* State, random_engine Engine, u64 Seed) {
+    *State = {};
+    State->Engine = Engine;
+    VisitRandomEngine(State, [Seed](auto* RandomState) { SeedRandom(RandomState, Seed); });
+}
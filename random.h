@@ -14,15 +14,14 @@
 #define ArrayLength(Array) ( sizeof(Array) / sizeof((Array)[0]) )
 #endif
 
-#ifdef USE_STANDARD_C_RNG
 #include <stdlib.h>
 struct standard_c_random_state {
     // NOTHING
 };
 
-standard_c_random_state StandardCRNGSeed(s32 Seed);
-s32 NextRandom(standard_c_random_state* Unused);
-#endif
+standard_c_random_state StandardCRNGSeed(u32 Seed);
+// NOTE: rand() only gives 31 bits, so this combines two calls to fill all 32
+u32 NextRandom(standard_c_random_state* Unused);
 
 // TODO: find a way to seed these from just 1 number
 
@@ -45,20 +44,470 @@ struct wichmann_hill_random_state2 {
 pcg_random_state PCGSeed(u64 InitialState, u64 InitialIncrement = 0);
 u32 NextRandom(pcg_random_state* RandomState);
 
+// Skips Delta values in O(log Delta)
+void PCGAdvance(pcg_random_state* RandomState, u64 Delta);
+
+// Cuts the sequence starting at Base into NumStreams back-to-back pieces of
+// StreamLength values each, so Streams[N] starts where Streams[N-1] would
+// reach after StreamLength values. Reading each stream for StreamLength values
+// gives the same numbers as reading Base for NumStreams * StreamLength values.
+// A StreamLength of 0 spaces the streams as far apart as possible.
+void PCGSplit(pcg_random_state Base, s32 NumStreams, u64 StreamLength, pcg_random_state* Streams);
+
 float NextRandom(wichmann_hill_random_state1* State);
 float NextRandom(wichmann_hill_random_state2* State);
 
+// Several independent PCG streams stepped together so that they can be
+// generated with SIMD. Value N of the combined stream always comes from lane
+// (N % PCGLaneCount) at step (N / PCGLaneCount), so the output only depends on
+// the seed and not on which instruction set generated it.
+#define PCGLaneCount 16
+
+struct pcg_multi_random_state {
+    alignas(64) u64 State[PCGLaneCount];
+    alignas(64) u64 Increment[PCGLaneCount];
+
+    // Values from a partially consumed step. Empty when BufferedIndex == PCGLaneCount
+    u32 Buffered[PCGLaneCount];
+    s32 BufferedIndex;
+};
+
+enum simd_level {
+    SIMDLevelScalar,
+    SIMDLevelSSE2,
+    SIMDLevelAVX2,
+    SIMDLevelAVX512,
+};
+
+pcg_multi_random_state PCGMultiSeed(u64 Seed);
+u32 NextRandom(pcg_multi_random_state* RandomState);
+void FillRandom(u32* Out, s64 Count, pcg_multi_random_state* RandomState);
+// Same as PCGAdvance and PCGSplit above, counted in values of the combined stream
+void PCGAdvance(pcg_multi_random_state* RandomState, u64 Delta);
+void PCGSplit(pcg_multi_random_state const* Base, s32 NumStreams, u64 StreamLength, pcg_multi_random_state* Streams);
+
+// Returns the level that is actually used, which is capped at what the CPU supports
+simd_level SetPCGSIMDLevel(simd_level Level);
+// Picks the fastest level this CPU has. Call it once at startup before any
+// thread rolls, since the level is a global that FillRandom reads.
+simd_level InitPCGSIMDLevel();
+simd_level GetPCGSIMDLevel();
+
+// xoshiro256** (Blackman and Vigna). Each 64-bit step gives two 32-bit values.
+struct xoshiro_random_state {
+    u64 S[4];
+
+    u32 SpareHalf;
+    b32 HasSpareHalf;
+};
+
+xoshiro_random_state XoshiroSeed(u64 Seed);
+u32 NextRandom(xoshiro_random_state* RandomState);
+u64 NextRandom64(xoshiro_random_state* RandomState);
+void FillRandom(u32* Out, s64 Count, xoshiro_random_state* RandomState);
+// Same as 2^128 calls to NextRandom64. Used to make non-overlapping streams.
+void XoshiroJump(xoshiro_random_state* RandomState);
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// Counter based, so value N is a pure function of the key, the stream and N.
+// Jumping to any position is free.
+struct philox_random_state {
+    u32 Key[2];
+    u64 Stream;   // The high half of the counter, which gives every stream 2^64 values of its own
+    u64 Position; // Index of the next value
+
+    u32 Block[4];
+    u64 BlockIndex; // Which block of 4 values is in Block
+};
+
+philox_random_state PhiloxSeed(u64 Seed);
+u32 NextRandom(philox_random_state* RandomState);
+void FillRandom(u32* Out, s64 Count, philox_random_state* RandomState);
+
+// Generic bulk generation. Generators with a faster bulk path provide an overload.
 template<class element, class random_state>
-void MakeRandomArray(int_size Length, element Array[], random_state* RandomState) {
-    for(int_size Index = 0; Index < Length; ++Index) {
-        Array[Index] = (element)NextRandom(RandomState);
+void FillRandom(element* Out, s64 Count, random_state* RandomState) {
+    for(s64 Index = 0; Index < Count; ++Index) {
+        Out[Index] = (element)NextRandom(RandomState);
+    }
+}
+
+// Unbiased number in [0, Bound) using Lemire's multiply-shift method. The
+// expensive modulo only happens when the low half lands in the biased region,
+// which is rare. Needs a generator that produces all 32 bits.
+template<class random_state>
+u32 NextBounded(random_state* RandomState, u32 Bound) {
+    u64 Product = (u64)(u32)NextRandom(RandomState) * Bound;
+    u32 Low = (u32)Product;
+
+    if(Low < Bound) {
+        u32 Threshold = (0u - Bound) % Bound;
+        while(Low < Threshold) {
+            Product = (u64)(u32)NextRandom(RandomState) * Bound;
+            Low = (u32)Product;
+        }
+    }
+
+    return (u32)(Product >> 32);
+}
+
+// Rolls Count dice with NumSides sides into Out (values 1 to NumSides).
+// Computes the rejection threshold once for the whole pool and pulls the raw
+// values in bulk. Consumes the generator exactly like Count calls to NextBounded.
+template<class random_state>
+void RollDice(random_state* RandomState, u32 NumSides, s64 Count, u32* Out) {
+    u32 Threshold = (0u - NumSides) % NumSides;
+    u32 RawBlock[256];
+
+    s64 Filled = 0;
+    while(Filled < Count) {
+        s64 BlockCount = Count - Filled;
+        if(BlockCount > (s64)ArrayLength(RawBlock)) {
+            BlockCount = ArrayLength(RawBlock);
+        }
+
+        FillRandom(RawBlock, BlockCount, RandomState);
+
+        // Rejected values get overwritten by the next accepted one
+        for(s64 Index = 0; Index < BlockCount; ++Index) {
+            u64 Product = (u64)RawBlock[Index] * NumSides;
+            Out[Filled] = (u32)(Product >> 32) + 1;
+            Filled += ((u32)Product >= Threshold);
+        }
+    }
+}
+
+// --- Engines
+//
+// An engine is any state type that has these overloads:
+//   void SeedRandom(state*, u64 Seed)
+//   u32  NextRandom(state*)
+//   u64  NextRandom64(state*)
+//   void FillRandom(u32* Out, s64 Count, state*)
+//   void AdvanceRandom(state*, u64 Delta)
+// Code that rolls dice is a template on the state type, so each engine gets its
+// own copy of the roll loop and nothing in it goes through a function pointer.
+
+template<class random_state>
+u64 NextRandom64(random_state* RandomState) {
+    u64 High = NextRandom(RandomState);
+    u64 Low  = NextRandom(RandomState);
+    return (High << 32) | Low;
+}
+
+inline void SeedRandom(pcg_random_state* RandomState, u64 Seed)        { *RandomState = PCGSeed(Seed); }
+inline void SeedRandom(pcg_multi_random_state* RandomState, u64 Seed)  { *RandomState = PCGMultiSeed(Seed); }
+inline void SeedRandom(xoshiro_random_state* RandomState, u64 Seed)    { *RandomState = XoshiroSeed(Seed); }
+inline void SeedRandom(philox_random_state* RandomState, u64 Seed)     { *RandomState = PhiloxSeed(Seed); }
+inline void SeedRandom(standard_c_random_state* RandomState, u64 Seed) { *RandomState = StandardCRNGSeed((u32)Seed); }
+
+inline void AdvanceRandom(pcg_random_state* RandomState, u64 Delta)       { PCGAdvance(RandomState, Delta); }
+inline void AdvanceRandom(pcg_multi_random_state* RandomState, u64 Delta) { PCGAdvance(RandomState, Delta); }
+inline void AdvanceRandom(philox_random_state* RandomState, u64 Delta)    { RandomState->Position += Delta; }
+
+// NOTE: These have no jump-ahead for arbitrary distances, so they step. Use
+// XoshiroJump to split xoshiro into streams.
+template<class random_state>
+void AdvanceRandom(random_state* RandomState, u64 Delta) {
+    for(u64 Index = 0; Index < Delta; ++Index) {
+        NextRandom(RandomState);
+    }
+}
+
+// Makes NumStreams copies of the engine that will never overlap in practice,
+// so each can be used on its own thread. Any of the copies can be split again,
+// or carry on as the engine and be split later, and the new streams won't
+// overlap the old ones either.
+void SplitRandom(pcg_random_state* Base, s32 NumStreams, pcg_random_state* Streams);
+void SplitRandom(pcg_multi_random_state* Base, s32 NumStreams, pcg_multi_random_state* Streams);
+void SplitRandom(xoshiro_random_state* Base, s32 NumStreams, xoshiro_random_state* Streams);
+void SplitRandom(philox_random_state* Base, s32 NumStreams, philox_random_state* Streams);
+// NOTE: rand() has a single hidden state, so the copies all share it
+void SplitRandom(standard_c_random_state* Base, s32 NumStreams, standard_c_random_state* Streams);
+
+// True for engines whose copies share state and so can't be used from several threads
+template<class random_state>
+b32 IsSharedRandom(random_state*) { return false; }
+inline b32 IsSharedRandom(standard_c_random_state*) { return true; }
+
+enum random_engine {
+    RandomEnginePCG,
+    RandomEngineXoshiro,
+    RandomEnginePhilox,
+    RandomEngineStandardC,
+
+    RandomEngineCount
+};
+
+extern char const* const RandomEngineNames[RandomEngineCount];
+
+// Returns RandomEngineCount if the name is not recognized
+random_engine RandomEngineFromName(char const* Name);
+
+// Holds whichever engine was picked at startup
+struct random_engine_state {
+    random_engine Engine;
+    union {
+        pcg_multi_random_state  PCG;
+        xoshiro_random_state    Xoshiro;
+        philox_random_state     Philox;
+        standard_c_random_state StandardC;
+    };
+};
+
+void SeedRandomEngine(random_engine_state* State, random_engine Engine, u64 Seed);
+
+// Calls Visitor with a pointer to the concrete engine state. This is the only
+// place the engine is switched on, so anything called from Visitor is compiled
+// separately for each engine.
+template<class visitor>
+auto VisitRandomEngine(random_engine_state* State, visitor Visitor) {
+    switch(State->Engine) {
+        case RandomEngineXoshiro:   return Visitor(&State->Xoshiro);
+        case RandomEnginePhilox:    return Visitor(&State->Philox);
+        case RandomEngineStandardC: return Visitor(&State->StandardC);
+        default:                    return Visitor(&State->PCG);
+    }
+}
+
+// --- Distributions
+
+// Uniform in [0, 1) with all 53 bits of precision
+template<class random_state>
+r64 NextUniformReal(random_state* RandomState) {
+    r64 Result = (r64)(NextRandom64(RandomState) >> 11) * (1.0 / 9007199254740992.0);
+    return Result;
+}
+
+// log(k!) - log of Stirling's approximation to k!
+inline r64 StirlingTail(s64 K) {
+    static r64 const SmallTails[] = {
+        0.0810614667953272, 0.0413406959554092, 0.0276779256849983, 0.02079067210376509,
+        0.0166446911898211, 0.0138761288230707, 0.0118967099458917, 0.0104112652619720,
+        0.00925546218271273, 0.00833056343336287,
+    };
+
+    r64 Result = 0;
+    if(K < (s64)ArrayLength(SmallTails)) {
+        Result = SmallTails[K];
+    } else {
+        r64 KPlus1Squared = (r64)(K + 1) * (r64)(K + 1);
+        Result = (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / KPlus1Squared) / KPlus1Squared) / (r64)(K + 1);
+    }
+    return Result;
+}
+
+// Exact sample of the number of successes in Count trials with probability
+// Probability. Expected cost does not depend on Count. Small means use
+// inversion, large means use Hormann's BTRS transformed rejection ("The
+// generation of binomial random variates", 1993).
+template<class random_state>
+s64 SampleBinomial(random_state* RandomState, s64 Count, r64 Probability) {
+    s64 Result = 0;
+
+    if(Count <= 0 || Probability <= 0) {
+        Result = 0;
+    } else if(Probability >= 1) {
+        Result = Count;
+    } else if(Probability > 0.5) {
+        Result = Count - SampleBinomial(RandomState, Count, 1 - Probability);
+    } else if((r64)Count * Probability < 10) {
+        r64 Q = 1 - Probability;
+        r64 S = Probability / Q;
+        r64 A = (r64)(Count + 1) * S;
+        r64 R = pow(Q, (r64)Count);
+        r64 U = NextUniformReal(RandomState);
+
+        while(U > R && Result < Count) {
+            U -= R;
+            ++Result;
+            R *= A / (r64)Result - S;
+        }
+    } else {
+        r64 N = (r64)Count;
+        r64 StdDev = sqrt(N * Probability * (1 - Probability));
+        r64 B = 1.15 + 2.53 * StdDev;
+        r64 A = -0.0873 + 0.0248 * B + 0.01 * Probability;
+        r64 C = N * Probability + 0.5;
+        r64 VR = 0.92 - 4.2 / B;
+        r64 R = Probability / (1 - Probability);
+        r64 Alpha = (2.83 + 5.1 / B) * StdDev;
+        r64 M = floor((N + 1) * Probability);
+
+        for(;;) {
+            r64 U = NextUniformReal(RandomState) - 0.5;
+            r64 V = NextUniformReal(RandomState);
+            r64 US = 0.5 - fabs(U);
+            r64 K = floor((2 * A / US + B) * U + C);
+
+            if(K < 0 || K > N) {
+                continue;
+            }
+
+            // Inside the box the hat is tight enough to accept without the full test
+            if(US >= 0.07 && V <= VR) {
+                Result = (s64)K;
+                break;
+            }
+
+            V = log(V * Alpha / (A / (US * US) + B));
+            r64 UpperBound = ((M + 0.5) * log((M + 1) / (R * (N - M + 1))) +
+                              (N + 1) * log((N - M + 1) / (N - K + 1)) +
+                              (K + 0.5) * log(R * (N - K + 1) / (K + 1)) +
+                              StirlingTail((s64)M) + StirlingTail((s64)(N - M)) -
+                              StirlingTail((s64)K) - StirlingTail((s64)(N - K)));
+            if(V <= UpperBound) {
+                Result = (s64)K;
+                break;
+            }
+        }
+    }
+
+    return Result;
+}
+
+// --- Pool
+//
+// A ring of pre-generated values that sits in front of an engine. Rolls copy
+// out of the ring instead of calling into the engine, and the ring gets
+// refilled in large blocks, ideally while waiting for input. Values come out
+// in the same order the engine made them, so seeds still replay exactly.
+
+#define RandomPoolSize      (1 << 14) // Must be a power of 2
+#define RandomPoolWatermark (RandomPoolSize / 4)
+
+struct random_pool {
+    alignas(64) u32 Words[RandomPoolSize];
+    u64 ReadIndex;  // Total values taken out
+    u64 WriteIndex; // Total values put in
+};
+
+// Engine concept wrapper that reads through the pool
+template<class random_state>
+struct pooled_random_state {
+    random_pool*  Pool;
+    random_state* Engine;
+};
+
+template<class random_state>
+pooled_random_state<random_state> PooledRandom(random_pool* Pool, random_state* Engine) {
+    pooled_random_state<random_state> Result = { Pool, Engine };
+    return Result;
+}
+
+// The engine behind a pool, for code that needs to split or copy the engine itself
+template<class random_state>
+random_state* UnpooledRandom(pooled_random_state<random_state>* RandomState) {
+    return RandomState->Engine;
+}
+
+template<class random_state>
+random_state* UnpooledRandom(random_state* RandomState) {
+    return RandomState;
+}
+
+template<class random_state>
+void RefillRandomPool(random_pool* Pool, random_state* Engine) {
+    u64 Space = RandomPoolSize - (Pool->WriteIndex - Pool->ReadIndex);
+    while(Space > 0) {
+        u64 Start = Pool->WriteIndex & (RandomPoolSize - 1);
+        u64 Chunk = RandomPoolSize - Start;
+        if(Chunk > Space) {
+            Chunk = Space;
+        }
+
+        FillRandom(Pool->Words + Start, (s64)Chunk, Engine);
+        Pool->WriteIndex += Chunk;
+        Space -= Chunk;
+    }
+}
+
+// For idle time. Only refills when the pool is getting low.
+template<class random_state>
+void TopUpRandomPool(random_pool* Pool, random_state* Engine) {
+    if(Pool->WriteIndex - Pool->ReadIndex < RandomPoolWatermark) {
+        RefillRandomPool(Pool, Engine);
+    }
+}
+
+template<class random_state>
+u32 NextRandom(pooled_random_state<random_state>* RandomState) {
+    random_pool* Pool = RandomState->Pool;
+    if(Pool->ReadIndex == Pool->WriteIndex) {
+        RefillRandomPool(Pool, RandomState->Engine);
+    }
+
+    u32 Result = Pool->Words[Pool->ReadIndex++ & (RandomPoolSize - 1)];
+    return Result;
+}
+
+template<class random_state>
+void FillRandom(u32* Out, s64 Count, pooled_random_state<random_state>* RandomState) {
+    random_pool* Pool = RandomState->Pool;
+
+    while(Count > 0) {
+        u64 Available = Pool->WriteIndex - Pool->ReadIndex;
+        if(Available == 0) {
+            if(Count >= RandomPoolSize) {
+                // The pool is drained, so the engine is at the right place to
+                // write big requests straight into Out without an extra copy.
+                FillRandom(Out, Count, RandomState->Engine);
+                break;
+            }
+
+            RefillRandomPool(Pool, RandomState->Engine);
+            Available = RandomPoolSize;
+        }
+
+        u64 Start = Pool->ReadIndex & (RandomPoolSize - 1);
+        u64 Chunk = RandomPoolSize - Start;
+        if(Chunk > Available) {
+            Chunk = Available;
+        }
+        if(Chunk > (u64)Count) {
+            Chunk = Count;
+        }
+
+        u32* Source = Pool->Words + Start;
+        for(u64 Index = 0; Index < Chunk; ++Index) {
+            Out[Index] = Source[Index];
+        }
+
+        Pool->ReadIndex += Chunk;
+        Out += Chunk;
+        Count -= Chunk;
     }
 }
 
+template<class element, class random_state>
+void MakeRandomArray(int_size Length, element Array[], random_state* RandomState) {
+    FillRandom(Array, Length, RandomState);
+}
+
+// Fisher-Yates. Each index is picked the same way as NextBounded so that every
+// order is equally likely, but with the raw values pulled in blocks.
 template<class element, class random_state>
 void ShuffleArray(int_size Length, element Array[], random_state* RandomState) {
+    u32 RandomBlock[64];
+    int_size RandomBlockIndex = ArrayLength(RandomBlock);
+
     for(int_size Index = 0; Index < Length-1; ++Index) {
-        int_size RandomIndex = NextRandom(RandomState) % (Length - Index) + Index;
+        u32 Bound = (u32)(Length - Index);
+        u64 Product;
+        for(;;) {
+            if(RandomBlockIndex == ArrayLength(RandomBlock)) {
+                FillRandom(RandomBlock, ArrayLength(RandomBlock), RandomState);
+                RandomBlockIndex = 0;
+            }
+
+            Product = (u64)RandomBlock[RandomBlockIndex++] * Bound;
+            u32 Low = (u32)Product;
+            if(Low >= Bound || Low >= (0u - Bound) % Bound) {
+                break;
+            }
+        }
+
+        int_size RandomIndex = (int_size)(Product >> 32) + Index;
 
         element Temp = Array[Index];
         Array[Index] = Array[RandomIndex];
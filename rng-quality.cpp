@@ -0,0 +1,494 @@
+/*
+  File: rng-quality.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Statistical test battery for the random engines, run with --test-rng.
+//
+// Every test is cut into one shard per thread. Each shard gets its own split of
+// the engine and counts what it sees, then the counts are merged and turned
+// into a p-value. A p-value very close to 0 or 1 means the output does not
+// look like fair dice.
+
+// --- Math
+
+// Q(A, X), the upper regularized incomplete gamma function
+internal r64
+RegularizedGammaQ(r64 A, r64 X) {
+    r64 Result = 1;
+    if(X > 0) {
+        r64 LogPrefix = -X + A * log(X) - lgamma(A);
+
+        if(X < A + 1) {
+            // Series for P(A, X)
+            r64 Term = 1 / A;
+            r64 Sum = Term;
+            for(s32 N = 1; N < 10000; ++N) {
+                Term *= X / (A + N);
+                Sum += Term;
+                if(fabs(Term) < fabs(Sum) * 1e-15) {
+                    break;
+                }
+            }
+            Result = 1 - Sum * exp(LogPrefix);
+        } else {
+            // Continued fraction for Q(A, X) using Lentz's method
+            r64 const Tiny = 1e-300;
+            r64 B = X + 1 - A;
+            r64 C = 1 / Tiny;
+            r64 D = 1 / B;
+            r64 H = D;
+            for(s32 N = 1; N < 10000; ++N) {
+                r64 AN = -N * (N - A);
+                B += 2;
+                D = AN * D + B;
+                D = fabs(D) < Tiny ? Tiny : D;
+                C = B + AN / C;
+                C = fabs(C) < Tiny ? Tiny : C;
+                D = 1 / D;
+                r64 Delta = D * C;
+                H *= Delta;
+                if(fabs(Delta - 1) < 1e-15) {
+                    break;
+                }
+            }
+            Result = exp(LogPrefix) * H;
+        }
+    }
+    return Result;
+}
+
+internal r64
+ChiSquarePValue(r64 ChiSquare, s32 DegreesOfFreedom) {
+    r64 Result = RegularizedGammaQ(DegreesOfFreedom / 2.0, ChiSquare / 2.0);
+    return Result;
+}
+
+// Two-sided p-value of a standard normal Z
+internal r64
+NormalPValue(r64 Z) {
+    r64 Result = erfc(fabs(Z) / sqrt(2.0));
+    return Result;
+}
+
+// --- Wichmann-Hill
+//
+// These return floats, so they are turned into 32-bit values to go through
+// the same tests. Only the top 24 bits can be set.
+
+template<class float_state>
+struct float_random_adapter {
+    float_state State;
+    u64 NumOnes; // Times 1.0 came out, which [0, 1) generators should never give
+};
+
+template<class float_state> internal u32
+NextRandom(float_random_adapter<float_state>* RandomState) {
+    r32 Value = NextRandom(&RandomState->State);
+    RandomState->NumOnes += (Value >= 1.0f);
+
+    r64 Scaled = (r64)Value * 4294967296.0;
+    u32 Result = Scaled >= 4294967295.0 ? 0xFFFFFFFF : (u32)Scaled;
+    return Result;
+}
+
+internal void
+SeedRandom(wichmann_hill_random_state1* RandomState, u64 Seed) {
+    RandomState->S1 = 1 + (s32)(SplitMix64(&Seed) % 30268);
+    RandomState->S2 = 1 + (s32)(SplitMix64(&Seed) % 30306);
+    RandomState->S3 = 1 + (s32)(SplitMix64(&Seed) % 30322);
+}
+
+internal void
+SeedRandom(wichmann_hill_random_state2* RandomState, u64 Seed) {
+    RandomState->S1 = 1 + (s32)(SplitMix64(&Seed) % 2147483578);
+    RandomState->S2 = 1 + (s32)(SplitMix64(&Seed) % 2147483542);
+    RandomState->S3 = 1 + (s32)(SplitMix64(&Seed) % 2147483422);
+    RandomState->S4 = 1 + (s32)(SplitMix64(&Seed) % 2147483122);
+}
+
+// These have no jump-ahead, so the shards are seeded separately
+template<class float_state> internal void
+SplitRandom(float_random_adapter<float_state>* Base, s32 NumStreams, float_random_adapter<float_state>* Streams) {
+    u64 SeedState = (u64)Base->State.S1 * 0x9E3779B97F4A7C15ULL + (u64)Base->State.S2;
+    for(s32 Index = 0; Index < NumStreams; ++Index) {
+        Streams[Index] = {};
+        SeedRandom(&Streams[Index].State, SplitMix64(&SeedState));
+    }
+}
+
+// --- Tests
+
+enum quality_test_type {
+    QualityTestFaces,    // Chi-square of how often each face of a die comes up
+    QualityTestGap,      // Chi-square of gap lengths between values below 1/8
+    QualityTestRuns,     // Number of runs above and below 1/2
+    QualityTestBirthday, // Marsaglia's birthday spacings, 512 birthdays in a year of 2^24 days
+    QualityTestSerial,   // Correlation of each value with the next one
+};
+
+struct quality_test {
+    quality_test_type Type;
+    s32 NumSides; // For QualityTestFaces
+    char const* Name;
+};
+
+global quality_test const QualityTests[] = {
+    { QualityTestFaces, 6,    "faces d6"   },
+    { QualityTestFaces, 20,   "faces d20"  },
+    { QualityTestFaces, 100,  "faces d100" },
+    // Odd side counts are where biased rolling would show up
+    { QualityTestFaces, 3,    "faces d3"   },
+    { QualityTestFaces, 7,    "faces d7"   },
+    { QualityTestFaces, 97,   "faces d97"  },
+    { QualityTestFaces, 997,  "faces d997" },
+    { QualityTestGap,     0,  "gap"        },
+    { QualityTestRuns,    0,  "runs"       },
+    { QualityTestBirthday, 0, "birthday"   },
+    { QualityTestSerial,  0,  "serial"     },
+};
+
+#define QualityMaxBins      1024
+#define GapTestBins         32
+#define BirthdaysPerYear    512
+#define BirthdayBits        24
+#define BirthdayLambda      2.0 // BirthdaysPerYear^3 / (4 * 2^BirthdayBits)
+#define BirthdayTestBins    8
+
+struct quality_counts {
+    s64 NumSamples;
+    u64 Bins[QualityMaxBins];
+
+    // Runs
+    s64 NumRuns;
+    r64 ExpectedRuns;
+    r64 RunsVariance;
+
+    // Serial correlation
+    r64 Sum;
+    r64 SumOfSquares;
+    r64 SumOfProducts;
+    s64 NumPairs;
+
+    u64 NumOnes;
+};
+
+template<class random_state>
+struct quality_shard {
+    quality_test const* Test;
+    random_state RandomState;
+    s64 NumSamples;
+    quality_counts Counts;
+    pthread_t Thread;
+    b32 Started;
+};
+
+#define QualityBlockSize 4096
+
+template<class random_state> internal void
+RunQualityShard(quality_shard<random_state>* Shard) {
+    quality_counts* Counts = &Shard->Counts;
+    random_state* RandomState = &Shard->RandomState;
+    u32 Block[QualityBlockSize];
+
+    s64 GapLength = -1; // -1 until the first hit
+    s32 LastBit = -1;
+    r64 LastValue = -1;
+
+    for(s64 Done = 0; Done < Shard->NumSamples; Done += QualityBlockSize) {
+        s64 NumValues = Shard->NumSamples - Done;
+        if(NumValues > QualityBlockSize) {
+            NumValues = QualityBlockSize;
+        }
+
+        switch(Shard->Test->Type) {
+            case QualityTestFaces: {
+                RollDice(RandomState, Shard->Test->NumSides, NumValues, Block);
+                for(s64 Index = 0; Index < NumValues; ++Index) {
+                    ++Counts->Bins[Block[Index] - 1];
+                }
+            } break;
+
+            case QualityTestGap: {
+                FillRandom(Block, NumValues, RandomState);
+                for(s64 Index = 0; Index < NumValues; ++Index) {
+                    if(Block[Index] < (1u << 29)) {
+                        if(GapLength >= 0) {
+                            ++Counts->Bins[GapLength < GapTestBins ? GapLength : GapTestBins];
+                        }
+                        GapLength = 0;
+                    } else if(GapLength >= 0) {
+                        ++GapLength;
+                    }
+                }
+            } break;
+
+            case QualityTestRuns: {
+                FillRandom(Block, NumValues, RandomState);
+                for(s64 Index = 0; Index < NumValues; ++Index) {
+                    s32 Bit = Block[Index] >> 31;
+                    Counts->NumRuns += (Bit != LastBit);
+                    LastBit = Bit;
+                }
+            } break;
+
+            case QualityTestBirthday: {
+                // Whole years only
+                NumValues -= NumValues % BirthdaysPerYear;
+                FillRandom(Block, NumValues, RandomState);
+
+                s32 Birthdays[BirthdaysPerYear];
+                s32 Buffer[BirthdaysPerYear];
+                for(s64 Year = 0; Year < NumValues; Year += BirthdaysPerYear) {
+                    for(s32 Index = 0; Index < BirthdaysPerYear; ++Index) {
+                        Birthdays[Index] = Block[Year + Index] >> (32 - BirthdayBits);
+                    }
+                    RadixSort(Array(s32, Birthdays), Array(s32, Buffer));
+
+                    for(s32 Index = BirthdaysPerYear - 1; Index > 0; --Index) {
+                        Birthdays[Index] -= Birthdays[Index - 1];
+                    }
+                    RadixSort(Array(s32, Birthdays), Array(s32, Buffer));
+
+                    s32 NumRepeats = 0;
+                    for(s32 Index = 1; Index < BirthdaysPerYear; ++Index) {
+                        NumRepeats += (Birthdays[Index] == Birthdays[Index - 1]);
+                    }
+                    ++Counts->Bins[NumRepeats < BirthdayTestBins ? NumRepeats : BirthdayTestBins];
+                }
+            } break;
+
+            case QualityTestSerial: {
+                FillRandom(Block, NumValues, RandomState);
+                for(s64 Index = 0; Index < NumValues; ++Index) {
+                    r64 Value = (r64)Block[Index] * (1.0 / 4294967296.0);
+                    Counts->Sum += Value;
+                    Counts->SumOfSquares += Value * Value;
+                    if(LastValue >= 0) {
+                        Counts->SumOfProducts += LastValue * Value;
+                        ++Counts->NumPairs;
+                    }
+                    LastValue = Value;
+                }
+            } break;
+        }
+
+        Counts->NumSamples += NumValues;
+    }
+
+    // Each shard is its own sequence, so the expected number of runs adds up per shard
+    r64 N = (r64)Counts->NumSamples;
+    Counts->ExpectedRuns = (N + 1) / 2;
+    Counts->RunsVariance = (N - 1) / 4;
+}
+
+internal u64
+NumOnesSeen(void*) {
+    return 0;
+}
+
+template<class float_state> internal u64
+NumOnesSeen(float_random_adapter<float_state>* RandomState) {
+    return RandomState->NumOnes;
+}
+
+template<class random_state> internal void*
+QualityShardProc(void* Data) {
+    quality_shard<random_state>* Shard = (quality_shard<random_state>*)Data;
+    RunQualityShard(Shard);
+    Shard->Counts.NumOnes = NumOnesSeen(&Shard->RandomState);
+    return NULL;
+}
+
+// Turns merged counts into a test statistic and p-value
+internal void
+EvaluateQualityTest(quality_test const* Test, quality_counts* Counts, r64* Statistic, r64* PValue) {
+    *Statistic = 0;
+    *PValue = 1;
+
+    switch(Test->Type) {
+        case QualityTestFaces: {
+            r64 Expected = (r64)Counts->NumSamples / Test->NumSides;
+            for(s32 Face = 0; Face < Test->NumSides; ++Face) {
+                r64 Difference = (r64)Counts->Bins[Face] - Expected;
+                *Statistic += Difference * Difference / Expected;
+            }
+            *PValue = ChiSquarePValue(*Statistic, Test->NumSides - 1);
+        } break;
+
+        case QualityTestGap: {
+            u64 NumGaps = 0;
+            for(s32 Bin = 0; Bin <= GapTestBins; ++Bin) {
+                NumGaps += Counts->Bins[Bin];
+            }
+
+            r64 P = 1.0 / 8;
+            for(s32 Bin = 0; Bin <= GapTestBins; ++Bin) {
+                r64 Probability = Bin < GapTestBins ? P * pow(1 - P, Bin) : pow(1 - P, GapTestBins);
+                r64 Expected = Probability * (r64)NumGaps;
+                r64 Difference = (r64)Counts->Bins[Bin] - Expected;
+                *Statistic += Difference * Difference / Expected;
+            }
+            *PValue = ChiSquarePValue(*Statistic, GapTestBins);
+        } break;
+
+        case QualityTestRuns: {
+            *Statistic = ((r64)Counts->NumRuns - Counts->ExpectedRuns) / sqrt(Counts->RunsVariance);
+            *PValue = NormalPValue(*Statistic);
+        } break;
+
+        case QualityTestBirthday: {
+            u64 NumYears = 0;
+            for(s32 Bin = 0; Bin <= BirthdayTestBins; ++Bin) {
+                NumYears += Counts->Bins[Bin];
+            }
+
+            r64 Cumulative = 0;
+            for(s32 Bin = 0; Bin <= BirthdayTestBins; ++Bin) {
+                r64 Probability = 0;
+                if(Bin < BirthdayTestBins) {
+                    Probability = exp(-BirthdayLambda + Bin * log(BirthdayLambda) - lgamma(Bin + 1));
+                    Cumulative += Probability;
+                } else {
+                    Probability = 1 - Cumulative;
+                }
+
+                r64 Expected = Probability * (r64)NumYears;
+                r64 Difference = (r64)Counts->Bins[Bin] - Expected;
+                *Statistic += Difference * Difference / Expected;
+            }
+            *PValue = ChiSquarePValue(*Statistic, BirthdayTestBins);
+        } break;
+
+        case QualityTestSerial: {
+            r64 N = (r64)Counts->NumSamples;
+            r64 Mean = Counts->Sum / N;
+            r64 Variance = Counts->SumOfSquares / N - Mean * Mean;
+            r64 Correlation = (Counts->SumOfProducts / (r64)Counts->NumPairs - Mean * Mean) / Variance;
+            *Statistic = Correlation * sqrt((r64)Counts->NumPairs);
+            *PValue = NormalPValue(*Statistic);
+        } break;
+    }
+}
+
+internal void
+MergeQualityCounts(quality_counts* Into, quality_counts* From) {
+    Into->NumSamples += From->NumSamples;
+    for(s32 Bin = 0; Bin < QualityMaxBins; ++Bin) {
+        Into->Bins[Bin] += From->Bins[Bin];
+    }
+    Into->NumRuns += From->NumRuns;
+    Into->ExpectedRuns += From->ExpectedRuns;
+    Into->RunsVariance += From->RunsVariance;
+    Into->Sum += From->Sum;
+    Into->SumOfSquares += From->SumOfSquares;
+    Into->SumOfProducts += From->SumOfProducts;
+    Into->NumPairs += From->NumPairs;
+    Into->NumOnes += From->NumOnes;
+}
+
+// p-values outside of [QualityFailLevel, 1 - QualityFailLevel] fail
+#define QualityFailLevel    1e-6
+#define QualitySuspectLevel 1e-3
+
+// Returns the number of failed tests
+template<class random_state> internal s32
+RunQualityTests(char const* EngineName, random_state* RandomState, s64 NumSamples, s32 NumShards) {
+    s32 NumFailed = 0;
+
+    quality_shard<random_state>* Shards = AllocateOnHeapTyped<quality_shard<random_state>>(NumShards);
+    random_state* Streams = AllocateOnHeapTyped<random_state>(NumShards + 1);
+
+    for(s32 TestIndex = 0; TestIndex < (s32)ArrayLength(QualityTests); ++TestIndex) {
+        quality_test const* Test = &QualityTests[TestIndex];
+
+        SplitRandom(RandomState, NumShards + 1, Streams);
+        for(s32 Index = 0; Index < NumShards; ++Index) {
+            quality_shard<random_state>* Shard = &Shards[Index];
+            ClearBytes(Shard, sizeof(*Shard));
+            Shard->Test = Test;
+            Shard->RandomState = Streams[Index];
+            Shard->NumSamples = NumSamples / NumShards + (Index < NumSamples % NumShards);
+        }
+        // Move on to the stream none of the shards got, so the next test is
+        // split from numbers this one doesn't see
+        *RandomState = Streams[NumShards];
+
+        for(s32 Index = 1; Index < NumShards; ++Index) {
+            Shards[Index].Started = (pthread_create(&Shards[Index].Thread, NULL, QualityShardProc<random_state>, &Shards[Index]) == 0);
+        }
+        QualityShardProc<random_state>(&Shards[0]);
+        for(s32 Index = 1; Index < NumShards; ++Index) {
+            if(Shards[Index].Started) {
+                pthread_join(Shards[Index].Thread, NULL);
+            } else {
+                QualityShardProc<random_state>(&Shards[Index]);
+            }
+        }
+
+        quality_counts* Counts = &Shards[0].Counts;
+        for(s32 Index = 1; Index < NumShards; ++Index) {
+            MergeQualityCounts(Counts, &Shards[Index].Counts);
+        }
+
+        r64 Statistic = 0, PValue = 0;
+        EvaluateQualityTest(Test, Counts, &Statistic, &PValue);
+
+        r64 Tail = PValue < 1 - PValue ? PValue : 1 - PValue;
+        char const* Verdict = "ok";
+        if(Tail < QualityFailLevel) {
+            Verdict = "FAIL";
+            ++NumFailed;
+        } else if(Tail < QualitySuspectLevel) {
+            Verdict = "suspect";
+        }
+
+        printf("%-16s %-12s %14lld %14.4f %12.6f  %s\n", EngineName, Test->Name,
+               (long long)Counts->NumSamples, Statistic, PValue, Verdict);
+        if(Counts->NumOnes > 0) {
+            printf("%-16s %-12s returned 1.0 %llu times\n", EngineName, Test->Name, (unsigned long long)Counts->NumOnes);
+        }
+        fflush(stdout);
+    }
+
+    DeallocateHeap(Streams);
+    DeallocateHeap(Shards);
+    return NumFailed;
+}
+
+// Runs the battery on one engine, or on all of them (including the
+// Wichmann-Hill generators) when AllEngines is set. Returns the number of failures.
+internal s32
+RunQualityBattery(random_engine_state* EngineState, b32 AllEngines, u64 Seed, s64 NumSamples, s32 NumThreads) {
+    s32 NumFailed = 0;
+
+    printf("%-16s %-12s %14s %14s %12s  %s\n", "engine", "test", "samples", "statistic", "p-value", "result");
+
+    for(s32 Engine = 0; Engine < RandomEngineCount; ++Engine) {
+        if(AllEngines || Engine == EngineState->Engine) {
+            random_engine_state State = {};
+            SeedRandomEngine(&State, (random_engine)Engine, Seed);
+
+            NumFailed += VisitRandomEngine(&State, [&](auto* RandomState) {
+                // rand() can't be split, so it runs as a single shard
+                s32 NumShards = IsSharedRandom(RandomState) ? 1 : NumThreads;
+                return RunQualityTests(RandomEngineNames[Engine], RandomState, NumSamples, NumShards);
+            });
+        }
+    }
+
+    if(AllEngines) {
+        float_random_adapter<wichmann_hill_random_state1> WichmannHill1 = {};
+        SeedRandom(&WichmannHill1.State, Seed);
+        NumFailed += RunQualityTests("wichmann_hill1", &WichmannHill1, NumSamples, NumThreads);
+
+        float_random_adapter<wichmann_hill_random_state2> WichmannHill2 = {};
+        SeedRandom(&WichmannHill2.State, Seed);
+        NumFailed += RunQualityTests("wichmann_hill2", &WichmannHill2, NumSamples, NumThreads);
+    }
+
+    printf("%d test%s failed\n", NumFailed, NumFailed == 1 ? "" : "s");
+    return NumFailed;
+}
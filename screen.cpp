@@ -0,0 +1,213 @@
+/*
+  File: screen.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// A full-screen view drawn in frames. Everything is drawn into the back
+// buffer, and PresentScreen compares it with the front buffer, which holds
+// what the terminal is showing, and only sends the cells that changed. The
+// whole frame goes out in one write, and nothing is cleared between frames,
+// so nothing flickers and a frame where little changed costs a few bytes.
+
+enum screen_style : u8 {
+    StyleNormal  = 0,
+    StyleBold    = 1,
+    StyleDim     = 2,
+    StyleReverse = 4,
+};
+
+struct screen_cell {
+    char Char;
+    u8 Style; // screen_style flags
+};
+
+internal inline b32
+CellsEqual(screen_cell A, screen_cell B) {
+    b32 Result = (A.Char == B.Char && A.Style == B.Style);
+    return Result;
+}
+
+// Going to a cell with an escape sequence takes 6 or more bytes, so gaps up to
+// this long between changed cells are written over instead
+#define ScreenMaxRewriteGap 4
+
+struct screen {
+    s32 Width;
+    s32 Height;
+    screen_cell* Front;
+    screen_cell* Back;
+
+    // Where the terminal's cursor is and which style it draws with. X is -1
+    // when it isn't known.
+    s32 CursorX;
+    s32 CursorY;
+    u8 Style;
+};
+
+internal inline screen_cell*
+ScreenCell(screen_cell* Cells, screen* Screen, s32 X, s32 Y) {
+    screen_cell* Result = &Cells[Y * Screen->Width + X];
+    return Result;
+}
+
+// Fits the buffers to the terminal and clears it
+internal void
+ResizeScreen(screen* Screen) {
+    vector2_i Size = GetWindowSize();
+    if(Size.X <= 0 || Size.Y <= 0) {
+        // Not a terminal, or it didn't say
+        Size.X = 80;
+        Size.Y = 24;
+    }
+
+    Screen->Width = Size.X;
+    Screen->Height = Size.Y;
+
+    int_size NumCells = (int_size)Screen->Width * Screen->Height;
+    Screen->Front = (screen_cell*)ReallocateOnHeap(Screen->Front, NumCells * sizeof(screen_cell));
+    Screen->Back = (screen_cell*)ReallocateOnHeap(Screen->Back, NumCells * sizeof(screen_cell));
+
+    // Whatever was left on the terminal is cleared once, here, so both buffers
+    // start out blank and the first frame only sends what isn't
+    WriteLiteral(&Output, "\x1b[0m\x1b[2J");
+    for(int_size Index = 0; Index < NumCells; ++Index) {
+        Screen->Front[Index] = { ' ', StyleNormal };
+        Screen->Back[Index] = { ' ', StyleNormal };
+    }
+    Screen->Style = StyleNormal;
+    Screen->CursorX = -1;
+}
+
+// Switches to the terminal's alternate screen, so what was there before comes
+// back in LeaveScreen
+internal void
+EnterScreen(screen* Screen) {
+    *Screen = {};
+    WriteLiteral(&Output, "\x1b[?1049h\x1b[?25l");
+    ResizeScreen(Screen);
+}
+
+internal void
+LeaveScreen(screen* Screen) {
+    WriteLiteral(&Output, "\x1b[0m\x1b[?25h\x1b[?1049l");
+    DeallocateHeap(Screen->Front);
+    DeallocateHeap(Screen->Back);
+    *Screen = {};
+}
+
+// --- Drawing into the back buffer
+
+internal void
+ClearScreenBuffer(screen* Screen) {
+    int_size NumCells = (int_size)Screen->Width * Screen->Height;
+    for(int_size Index = 0; Index < NumCells; ++Index) {
+        Screen->Back[Index] = { ' ', StyleNormal };
+    }
+}
+
+// Clipped to the screen. Returns the column just past the text.
+internal s32
+DrawText(screen* Screen, s32 X, s32 Y, string Text, u8 Style = StyleNormal) {
+    if(Y >= 0 && Y < Screen->Height) {
+        for(int_size Index = 0; Index < Text.Length; ++Index) {
+            s32 Column = X + (s32)Index;
+            if(Column >= 0 && Column < Screen->Width) {
+                *ScreenCell(Screen->Back, Screen, Column, Y) = { Text.Contents[Index], Style };
+            }
+        }
+    }
+    s32 Result = X + (s32)Text.Length;
+    return Result;
+}
+
+// printf onto the screen. Anything past 256 characters is cut off.
+internal s32
+DrawFormat(screen* Screen, s32 X, s32 Y, u8 Style, char const* Format, ...) {
+    char Text[256];
+    va_list Args;
+    va_start(Args, Format);
+    int_size Length = vsnprintf(Text, sizeof(Text), Format, Args);
+    va_end(Args);
+
+    if(Length > (int_size)sizeof(Text) - 1) {
+        Length = sizeof(Text) - 1;
+    }
+    s32 Result = DrawText(Screen, X, Y, StringWithLength(Text, Length), Style);
+    return Result;
+}
+
+internal void
+FillCells(screen* Screen, s32 X, s32 Y, s32 Length, char Char, u8 Style = StyleNormal) {
+    if(Y >= 0 && Y < Screen->Height) {
+        for(s32 Column = X; Column < X + Length; ++Column) {
+            if(Column >= 0 && Column < Screen->Width) {
+                *ScreenCell(Screen->Back, Screen, Column, Y) = { Char, Style };
+            }
+        }
+    }
+}
+
+// --- Sending a frame
+
+internal void
+SetScreenStyle(screen* Screen, u8 Style) {
+    if(Style != Screen->Style) {
+        WriteLiteral(&Output, "\x1b[0");
+        if(Style & StyleBold) {
+            WriteLiteral(&Output, ";1");
+        }
+        if(Style & StyleDim) {
+            WriteLiteral(&Output, ";2");
+        }
+        if(Style & StyleReverse) {
+            WriteLiteral(&Output, ";7");
+        }
+        WriteByte(&Output, 'm');
+        Screen->Style = Style;
+    }
+}
+
+internal void
+PutScreenCell(screen* Screen, s32 X, s32 Y) {
+    screen_cell Cell = *ScreenCell(Screen->Back, Screen, X, Y);
+    SetScreenStyle(Screen, Cell.Style);
+    WriteByte(&Output, Cell.Char);
+    *ScreenCell(Screen->Front, Screen, X, Y) = Cell;
+
+    // After the last column the terminal is waiting to wrap, and where the
+    // cursor is depends on the terminal
+    Screen->CursorX = (X + 1 < Screen->Width) ? X + 1 : -1;
+    Screen->CursorY = Y;
+}
+
+// Sends the cells that differ from the last frame, in one write
+internal void
+PresentScreen(screen* Screen) {
+    for(s32 Y = 0; Y < Screen->Height; ++Y) {
+        screen_cell* BackRow = ScreenCell(Screen->Back, Screen, 0, Y);
+        screen_cell* FrontRow = ScreenCell(Screen->Front, Screen, 0, Y);
+
+        for(s32 X = 0; X < Screen->Width; ++X) {
+            if(!CellsEqual(BackRow[X], FrontRow[X])) {
+                s32 Gap = X - Screen->CursorX;
+                if(Screen->CursorX >= 0 && Screen->CursorY == Y && Gap >= 0 && Gap <= ScreenMaxRewriteGap) {
+                    // Cheaper to write the cells in between again than to jump over them
+                    for(s32 Between = Screen->CursorX; Between < X; ++Between) {
+                        PutScreenCell(Screen, Between, Y);
+                    }
+                } else {
+                    WriteLiteral(&Output, "\x1b[");
+                    WriteInt(&Output, Y + 1);
+                    WriteByte(&Output, ';');
+                    WriteInt(&Output, X + 1);
+                    WriteByte(&Output, 'H');
+                }
+                PutScreenCell(Screen, X, Y);
+            }
+        }
+    }
+
+    FlushOutput(&Output);
+}
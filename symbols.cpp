@@ -0,0 +1,219 @@
+/*
+  File: symbols.cpp
+  Date: 17 October 2026
+  Creator: Alexandru Filip
+  Notice: (C) Copyright 2026 by Alexandru Filip. All rights reserved.
+*/
+
+// Names in commands become integer IDs as they are read, so everything after
+// the tokenizer compares IDs instead of strings. Keywords have fixed IDs and
+// are found with a perfect hash that is made at compile time. Every other name
+// gets the next free ID from a table that lives in the command's arena.
+
+typedef s32 symbol;
+
+enum keyword {
+    KeywordNone, // Not a keyword, or not a symbol at all
+
+    KeywordQuit,
+    KeywordExit,
+    KeywordDist,
+    KeywordSim,
+    KeywordAdv,
+    KeywordDis,
+    KeywordWatch,
+    KeywordAdd,    // Reserved
+    KeywordRemove, // Reserved
+
+    KeywordCount, // Names that aren't keywords are numbered from here
+};
+
+global constexpr char const* KeywordNames[KeywordCount] = {
+    "", "quit", "exit", "dist", "sim", "adv", "dis", "watch", "add", "remove",
+};
+
+// FNV-1a, with Seed mixed into the starting value
+constexpr u32
+HashName(char const* Name, int_size Length, u32 Seed) {
+    u32 Result = 2166136261u ^ Seed;
+    for(int_size Index = 0; Index < Length; ++Index) {
+        Result = (Result ^ (u8)Name[Index]) * 16777619u;
+    }
+    return Result;
+}
+
+// --- Keywords
+
+// Slots are picked with the top bits of the hash. The low bits of FNV-1a only
+// depend on the low bits of the seed and the name, so they don't spread out.
+#define KeywordTableBits 4
+#define KeywordTableSize (1 << KeywordTableBits)
+
+struct keyword_table {
+    u32 Seed;
+    u8 Keywords[KeywordTableSize]; // KeywordNone in empty slots
+    u8 Lengths[KeywordCount];
+    u8 MaxLength;
+};
+
+constexpr int_size
+ConstantStringLength(char const* Text) {
+    int_size Result = 0;
+    while(Text[Result]) {
+        ++Result;
+    }
+    return Result;
+}
+
+// Tries seeds until every keyword hashes to a slot of its own
+constexpr keyword_table
+MakeKeywordTable() {
+    keyword_table Result = {};
+    for(u32 Seed = 1; Result.Seed == 0; ++Seed) {
+        keyword_table Table = {};
+        Table.Seed = Seed;
+
+        b32 Collided = false;
+        for(s32 Keyword = KeywordNone + 1; Keyword < KeywordCount && !Collided; ++Keyword) {
+            int_size Length = ConstantStringLength(KeywordNames[Keyword]);
+            u32 Slot = HashName(KeywordNames[Keyword], Length, Seed) >> (32 - KeywordTableBits);
+
+            Collided = (Table.Keywords[Slot] != KeywordNone);
+            Table.Keywords[Slot] = (u8)Keyword;
+            Table.Lengths[Keyword] = (u8)Length;
+            if(Length > Table.MaxLength) {
+                Table.MaxLength = (u8)Length;
+            }
+        }
+
+        if(!Collided) {
+            Result = Table;
+        }
+    }
+    return Result;
+}
+
+global constexpr keyword_table KeywordTable = MakeKeywordTable();
+
+// One hash and one comparison
+internal keyword
+LookupKeyword(string Name) {
+    keyword Result = KeywordNone;
+    if(Name.Length <= KeywordTable.MaxLength) {
+        u32 Slot = HashName(Name.Contents, Name.Length, KeywordTable.Seed) >> (32 - KeywordTableBits);
+        u8 Keyword = KeywordTable.Keywords[Slot];
+        if(Keyword != KeywordNone && KeywordTable.Lengths[Keyword] == Name.Length &&
+           memcmp(Name.Contents, KeywordNames[Keyword], Name.Length) == 0) {
+            Result = (keyword)Keyword;
+        }
+    }
+    return Result;
+}
+
+// --- Interning
+//
+// Open addressing with linear probing. The table doubles before it is half
+// full, and the old slots are left in the arena.
+
+#define SymbolTableInitialSlots 64
+
+// First slot to try. The high bits are folded in for the same reason the
+// keyword table only uses them.
+internal inline u32
+FirstSymbolSlot(u32 Hash, u32 Mask) {
+    u32 Result = (Hash ^ (Hash >> 16)) & Mask;
+    return Result;
+}
+
+struct symbol_slot {
+    u32 Hash;
+    symbol Symbol; // KeywordNone if the slot is empty
+};
+
+struct symbol_table {
+    memory_arena* Arena;
+
+    symbol_slot* Slots;
+    s32 NumSlots; // Power of 2
+
+    string* Names; // Names[Symbol - KeywordCount], with room for NumSlots / 2
+    s32 NumNames;
+};
+
+// Nothing else is allocated until the first name is interned
+internal symbol_table*
+NewSymbolTable(memory_arena* Arena) {
+    symbol_table* Result = PushTyped<symbol_table>(Arena);
+    ClearBytes(Result, sizeof(*Result));
+    Result->Arena = Arena;
+    return Result;
+}
+
+internal void
+GrowSymbolTable(symbol_table* Table) {
+    s32 NumSlots = Table->NumSlots > 0 ? 2 * Table->NumSlots : SymbolTableInitialSlots;
+    u32 Mask = NumSlots - 1;
+
+    symbol_slot* Slots = PushTyped<symbol_slot>(Table->Arena, NumSlots);
+    ClearBytes(Slots, sizeof(symbol_slot) * NumSlots);
+    for(s32 Index = 0; Index < Table->NumSlots; ++Index) {
+        symbol_slot Slot = Table->Slots[Index];
+        if(Slot.Symbol != KeywordNone) {
+            u32 NewIndex = FirstSymbolSlot(Slot.Hash, Mask);
+            while(Slots[NewIndex].Symbol != KeywordNone) {
+                NewIndex = (NewIndex + 1) & Mask;
+            }
+            Slots[NewIndex] = Slot;
+        }
+    }
+
+    string* Names = PushTyped<string>(Table->Arena, NumSlots / 2);
+    for(s32 Index = 0; Index < Table->NumNames; ++Index) {
+        Names[Index] = Table->Names[Index];
+    }
+
+    Table->Slots = Slots;
+    Table->NumSlots = NumSlots;
+    Table->Names = Names;
+}
+
+// Keywords come back as themselves. Any other name gets the same ID every time
+// it is interned in the same table, or KeywordNone if there is no table. The
+// table keeps Name, not a copy of it.
+internal symbol
+InternSymbol(symbol_table* Table, string Name) {
+    symbol Result = LookupKeyword(Name);
+    if(Result == KeywordNone && Table) {
+        if(2 * (Table->NumNames + 1) > Table->NumSlots) {
+            GrowSymbolTable(Table);
+        }
+
+        u32 Hash = HashName(Name.Contents, Name.Length, 0);
+        u32 Mask = Table->NumSlots - 1;
+        for(u32 Index = FirstSymbolSlot(Hash, Mask);; Index = (Index + 1) & Mask) {
+            symbol_slot* Slot = &Table->Slots[Index];
+            if(Slot->Symbol == KeywordNone) {
+                Slot->Hash = Hash;
+                Slot->Symbol = KeywordCount + Table->NumNames;
+                Table->Names[Table->NumNames++] = Name;
+                Result = Slot->Symbol;
+                break;
+            } else if(Slot->Hash == Hash && StringsEqual(Table->Names[Slot->Symbol - KeywordCount], Name)) {
+                Result = Slot->Symbol;
+                break;
+            }
+        }
+    }
+    return Result;
+}
+
+internal string
+SymbolName(symbol_table* Table, symbol Symbol) {
+    string Result = {};
+    if(Symbol < KeywordCount) {
+        Result = StringFromC(KeywordNames[Symbol]);
+    } else {
+        Result = Table->Names[Symbol - KeywordCount];
+    }
+    return Result;
+}
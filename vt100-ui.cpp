@@ -7,134 +7,552 @@
 
 // TODO: The functions below have nothing to do with vt100 and should be factored out into their own file
 
-struct pipe_fds {
-    s32 ReadHead;
-    s32 WriteHead;
-};
-
-enum SpecialCharType : s32 {
-    WindowResized = 256
-};
+global s32 EPollFileDescriptor = -1;
+global s32 NumRegisteredEPollFDs;
 
-global pipe_fds InternalMessagePipe;
-global b32 InternalMessagePipeExists;
+// How many ready descriptors one wait takes in. The set itself can hold any
+// number of them; the rest are picked up by the next wait.
+#define EPollEventsPerWait 16
 
-global s32 EPollFileDescriptor;
-global struct epoll_event EPollEventBuffer[16];
-global s32 NumEPollEvents;
-global s32 EPollBufferIndex;
-global s32 NumRegisteredEPollFDs;
+internal void
+InitEPoll() {
+    EPollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+}
 
+// Events are EPOLLIN and EPOLLOUT flags
 internal void
-RegisterFDForEPollRead(s32 FileDescriptor) {
-    if(NumRegisteredEPollFDs < ArrayLength(EPollEventBuffer)) {
-        struct epoll_event EventData = {};
-        EventData.events = EPOLLIN;
-        EventData.data.fd = FileDescriptor;
+RegisterFDForEPoll(s32 FileDescriptor, u32 Events) {
+    struct epoll_event EventData = {};
+    EventData.events = Events;
+    EventData.data.fd = FileDescriptor;
 
-        epoll_ctl(EPollFileDescriptor, EPOLL_CTL_ADD, FileDescriptor, &EventData);
+    if(epoll_ctl(EPollFileDescriptor, EPOLL_CTL_ADD, FileDescriptor, &EventData) == 0) {
         NumRegisteredEPollFDs += 1;
     }
 }
 
 internal void
-UnRegisterFDForEPollRead(s32 FileDescriptor) {
-    // Assumes FileDescriptor is registered since there is no way to check
-    if(NumRegisteredEPollFDs >= 0) {
-        struct epoll_event EventData = {};
-        EventData.data.fd = FileDescriptor;
+RegisterFDForEPollRead(s32 FileDescriptor) {
+    RegisterFDForEPoll(FileDescriptor, EPOLLIN);
+}
+
+// Changes what a registered descriptor is waited on for. 0 keeps it in the set
+// without waking up for it.
+internal void
+ChangeEPollEvents(s32 FileDescriptor, u32 Events) {
+    struct epoll_event EventData = {};
+    EventData.events = Events;
+    EventData.data.fd = FileDescriptor;
+
+    epoll_ctl(EPollFileDescriptor, EPOLL_CTL_MOD, FileDescriptor, &EventData);
+}
+
+internal void
+UnRegisterFDForEPoll(s32 FileDescriptor) {
+    struct epoll_event EventData = {};
+    EventData.data.fd = FileDescriptor;
 
-        epoll_ctl(EPollFileDescriptor, EPOLL_CTL_DEL, FileDescriptor, &EventData);
+    if(epoll_ctl(EPollFileDescriptor, EPOLL_CTL_DEL, FileDescriptor, &EventData) == 0) {
         NumRegisteredEPollFDs -= 1;
     }
 }
 
-internal s32
-NextEPollFD() {
-    s32 Result = 0;
-    struct epoll_event EventData = EPollEventBuffer[EPollBufferIndex];
+internal void
+DebugPrint(char const* Format, ...) {
+    // Print at a predictable location
+}
 
-    EPollBufferIndex++;
-    NumEPollEvents -= 1;
+internal void
+WriteChar(char C) {
+    WriteByte(&Output, C);
+}
 
-    Result = EventData.data.fd;
+// --- Input
+//
+// Every wakeup drains everything stdin has into a ring buffer with one read,
+// and keys are decoded from there, so a paste or a burst of mouse reports
+// costs one syscall instead of one per byte. Escape sequences are decoded by
+// a table-driven state machine: each byte is put in a class, and the state and
+// class pick what to do with it and which state comes next.
+//
+// Signals and timers come through the same epoll set as stdin. The signals
+// that matter are blocked and read from a signalfd, and the escape timeout and
+// the frame timer for full-screen views are timerfds, so they all turn into
+// events in one place.
+
+// Power of 2
+#define InputRingSize 4096
+
+// How long to wait for the rest of an escape sequence before deciding it was
+// the Escape key on its own
+#define EscapeSequenceTimeoutMS 25
+
+// Parameters and bytes kept from one sequence
+#define MaxSequenceParameters 8
+#define MaxSequenceLength 32
+
+enum key_type {
+    KeyNone,
+    KeyChar,    // Anything that isn't an escape sequence, including control characters
+    KeyAlt,     // Escape followed by Char
+    KeyEscape,
+    KeyUp,
+    KeyDown,
+    KeyRight,
+    KeyLeft,
+    KeyHome,
+    KeyEnd,
+    KeyInsert,
+    KeyDelete,
+    KeyPageUp,
+    KeyPageDown,
+    KeyMouse,
+    KeyWindowResized,   // SIGWINCH
+    KeyInterrupt,       // SIGINT
+    KeyTerminate,       // SIGTERM
+    KeyFrame,           // The frame timer went off
+    KeyUnknownSequence, // Sequence holds the bytes
+};
 
+// From xterm's modifier parameter, minus one
+enum key_modifier {
+    ModifierShift   = 1,
+    ModifierAlt     = 2,
+    ModifierControl = 4,
+};
+
+struct key_event {
+    key_type Type;
+    s32 Char;      // For KeyChar and KeyAlt
+    s32 Modifiers; // key_modifier flags
+
+    // SGR-1006 mouse reports. X and Y start at 1.
+    s32 MouseButton;
+    s32 MouseX;
+    s32 MouseY;
+    b32 MouseReleased;
+
+    string Sequence; // Valid until the next ReadKey
+};
+
+enum input_state : u8 {
+    InputGround,
+    InputEscape, // After ESC
+    InputCSI,    // After ESC [
+    InputSS3,    // After ESC O
+
+    InputStateCount,
+};
+
+enum input_class : u8 {
+    InputClassOther,
+    InputClassEscape,
+    InputClassOpenBracket, // [
+    InputClassLetterO,     // O
+    InputClassDigit,
+    InputClassSemicolon,
+    InputClassPrivate,     // < (and = > ?), which start SGR mouse reports and other private sequences
+    InputClassFinal,       // The rest of 0x40 to 0x7E, which end a CSI sequence
+
+    InputClassCount,
+};
+
+enum input_action : u8 {
+    InputActionKey,        // The byte is a key
+    InputActionStart,      // Start a new sequence
+    InputActionCollect,    // Keep going
+    InputActionDigit,      // Add a digit to the parameter
+    InputActionParameter,  // Start the next parameter
+    InputActionPrivate,    // Mark the sequence as private
+    InputActionAlt,        // ESC and a key
+    InputActionEscapeKey,  // ESC on its own, and the byte starts a new sequence
+    InputActionDispatchCSI,
+    InputActionDispatchSS3,
+    InputActionUnknown,    // Not a sequence this understands
+};
+
+struct input_transition {
+    input_action Action;
+    input_state Next;
+};
+
+struct input_tables {
+    input_class Classes[256];
+    input_transition Transitions[InputStateCount][InputClassCount];
+};
+
+constexpr input_tables
+MakeInputTables() {
+    input_tables Result = {};
+    for(s32 Byte = 0x40; Byte <= 0x7E; ++Byte) {
+        Result.Classes[Byte] = InputClassFinal;
+    }
+    for(s32 Byte = '0'; Byte <= '9'; ++Byte) {
+        Result.Classes[Byte] = InputClassDigit;
+    }
+    Result.Classes[0x1b] = InputClassEscape;
+    Result.Classes['['] = InputClassOpenBracket;
+    Result.Classes['O'] = InputClassLetterO;
+    Result.Classes[';'] = InputClassSemicolon;
+    Result.Classes['<'] = InputClassPrivate;
+    Result.Classes['='] = InputClassPrivate;
+    Result.Classes['>'] = InputClassPrivate;
+    Result.Classes['?'] = InputClassPrivate;
+
+    for(s32 Class = 0; Class < InputClassCount; ++Class) {
+        Result.Transitions[InputGround][Class] = { InputActionKey, InputGround };
+        Result.Transitions[InputEscape][Class] = { InputActionAlt, InputGround };
+        Result.Transitions[InputCSI][Class]    = { InputActionUnknown, InputGround };
+        Result.Transitions[InputSS3][Class]    = { InputActionUnknown, InputGround };
+    }
+    Result.Transitions[InputGround][InputClassEscape] = { InputActionStart, InputEscape };
+
+    Result.Transitions[InputEscape][InputClassEscape]      = { InputActionEscapeKey, InputEscape };
+    Result.Transitions[InputEscape][InputClassOpenBracket] = { InputActionCollect, InputCSI };
+    Result.Transitions[InputEscape][InputClassLetterO]     = { InputActionCollect, InputSS3 };
+
+    // ESC [ [ A is F1 on the Linux console, so [ and O end a sequence like any final byte
+    Result.Transitions[InputCSI][InputClassDigit]       = { InputActionDigit, InputCSI };
+    Result.Transitions[InputCSI][InputClassSemicolon]   = { InputActionParameter, InputCSI };
+    Result.Transitions[InputCSI][InputClassPrivate]     = { InputActionPrivate, InputCSI };
+    Result.Transitions[InputCSI][InputClassFinal]       = { InputActionDispatchCSI, InputGround };
+    Result.Transitions[InputCSI][InputClassOpenBracket] = { InputActionDispatchCSI, InputGround };
+    Result.Transitions[InputCSI][InputClassLetterO]     = { InputActionDispatchCSI, InputGround };
+    Result.Transitions[InputCSI][InputClassEscape]      = { InputActionUnknown, InputEscape };
+
+    Result.Transitions[InputSS3][InputClassFinal]       = { InputActionDispatchSS3, InputGround };
+    Result.Transitions[InputSS3][InputClassOpenBracket] = { InputActionDispatchSS3, InputGround };
+    Result.Transitions[InputSS3][InputClassLetterO]     = { InputActionDispatchSS3, InputGround };
     return Result;
 }
 
+global constexpr input_tables InputTables = MakeInputTables();
+
+struct input_decoder {
+    u8 Ring[InputRingSize];
+    u32 ReadIndex;  // Both only go up, and are masked when used
+    u32 WriteIndex;
+
+    // Signals that came in and haven't been handed out yet
+    s32 PendingResizes;
+    s32 PendingInterrupts;
+    b32 PendingTerminate;
+    b32 PendingFrame; // Frames that were missed are dropped, not queued up
+
+    // The escape timeout is armed the first time a sequence is left hanging, and
+    // isn't pushed back by wakeups for anything else
+    b32 TimerArmed;
+    b32 TimedOut;
+
+    input_state State;
+    b32 IsPrivate;
+    s32 Parameters[MaxSequenceParameters];
+    s32 NumParameters;
+    char Sequence[MaxSequenceLength];
+    s32 SequenceLength;
+    char Unknown[MaxSequenceLength]; // The last unknown sequence, for KeyUnknownSequence
+};
+
+global input_decoder InputDecoder;
+
+global s32 SignalFileDescriptor = -1;
+global s32 EscapeTimerFileDescriptor = -1;
+global s32 FrameTimerFileDescriptor = -1;
+
+// One-shot, or disarmed if Milliseconds is 0. Changing the timer also drops an
+// expiry that hasn't been read yet.
 internal void
-DebugPrint(char const* Format, ...) {
-    // Print at a predictable location
+SetEscapeTimer(input_decoder* Decoder, s32 Milliseconds) {
+    struct itimerspec Timer = {};
+    Timer.it_value.tv_sec = Milliseconds / 1000;
+    Timer.it_value.tv_nsec = (Milliseconds % 1000) * 1000000L;
+    timerfd_settime(EscapeTimerFileDescriptor, 0, &Timer, NULL);
+
+    Decoder->TimerArmed = (Milliseconds > 0);
+    Decoder->TimedOut = false;
 }
 
+// ReadKey hands out a KeyFrame every Milliseconds, or stops if it is 0
 internal void
-WriteChar(char C) {
-    write(STDOUT_FILENO, &C, 1);
+SetFrameTimer(s32 Milliseconds) {
+    struct itimerspec Timer = {};
+    Timer.it_value.tv_sec = Milliseconds / 1000;
+    Timer.it_value.tv_nsec = (Milliseconds % 1000) * 1000000L;
+    Timer.it_interval = Timer.it_value;
+    timerfd_settime(FrameTimerFileDescriptor, 0, &Timer, NULL);
+
+    if(Milliseconds == 0) {
+        InputDecoder.PendingFrame = false;
+    }
+}
+
+// Blocks until something comes in on any of the registered descriptors, and
+// takes in all of it
+internal void
+WaitForInput(input_decoder* Decoder) {
+    // Everything drawn since the last key goes out in one write before waiting
+    FlushOutput(&Output);
+
+    struct epoll_event Events[EPollEventsPerWait];
+    s32 NumEvents = epoll_wait(EPollFileDescriptor, Events, ArrayLength(Events), -1);
+
+    for(s32 Index = 0; Index < NumEvents; ++Index) {
+        s32 FileDescriptor = Events[Index].data.fd;
+        if(FileDescriptor == SignalFileDescriptor) {
+            struct signalfd_siginfo Signals[8];
+            ssize_t NumRead;
+            while((NumRead = read(SignalFileDescriptor, Signals, sizeof(Signals))) > 0) {
+                for(s32 SignalIndex = 0; SignalIndex < NumRead / (ssize_t)sizeof(Signals[0]); ++SignalIndex) {
+                    switch(Signals[SignalIndex].ssi_signo) {
+                        case SIGWINCH: ++Decoder->PendingResizes;    break;
+                        case SIGINT:   ++Decoder->PendingInterrupts; break;
+                        case SIGTERM:  Decoder->PendingTerminate = true; break;
+                        default: break;
+                    }
+                }
+            }
+        } else if(FileDescriptor == EscapeTimerFileDescriptor) {
+            u64 NumExpirations = 0;
+            if(read(EscapeTimerFileDescriptor, &NumExpirations, sizeof(NumExpirations)) == sizeof(NumExpirations)) {
+                Decoder->TimerArmed = false;
+                Decoder->TimedOut = true;
+            }
+        } else if(FileDescriptor == FrameTimerFileDescriptor) {
+            u64 NumExpirations = 0;
+            if(read(FrameTimerFileDescriptor, &NumExpirations, sizeof(NumExpirations)) == sizeof(NumExpirations)) {
+                Decoder->PendingFrame = true;
+            }
+        } else if(FileDescriptor == STDIN_FILENO) {
+            // The free part of the ring can wrap around, so it is read as two pieces
+            u32 Used = Decoder->WriteIndex - Decoder->ReadIndex;
+            u32 Start = Decoder->WriteIndex & (InputRingSize - 1);
+            u32 Free = InputRingSize - Used;
+            u32 FirstLength = InputRingSize - Start < Free ? InputRingSize - Start : Free;
+
+            struct iovec Pieces[2] = {};
+            Pieces[0].iov_base = Decoder->Ring + Start;
+            Pieces[0].iov_len = FirstLength;
+            Pieces[1].iov_base = Decoder->Ring;
+            Pieces[1].iov_len = Free - FirstLength;
+
+            ssize_t NumRead = readv(STDIN_FILENO, Pieces, Pieces[1].iov_len > 0 ? 2 : 1);
+            if(NumRead > 0) {
+                Decoder->WriteIndex += (u32)NumRead;
+            }
+        }
+    }
 }
 
 internal s32
-ReadChar() {
-    s32 Result = 0;
-    if(NumEPollEvents <= 0) {
-        NumEPollEvents = epoll_wait(EPollFileDescriptor, EPollEventBuffer, ArrayLength(EPollEventBuffer), -1);
-        EPollBufferIndex = 0;
+SequenceParameter(input_decoder* Decoder, s32 Index, s32 Default) {
+    s32 Result = Default;
+    if(Index < Decoder->NumParameters && Decoder->Parameters[Index] > 0) {
+        Result = Decoder->Parameters[Index];
     }
+    return Result;
+}
 
-    s32 FileDescriptor = NextEPollFD();
-    if(InternalMessagePipeExists && FileDescriptor == InternalMessagePipe.ReadHead) {
-        // printf("\r\nInternal message pipe\r\n");
-        if(read(InternalMessagePipe.ReadHead, &Result, sizeof(SpecialCharType)) > 0) {
-            // TODO: Allow for the ability to send extra info in this special pipe without using switch-case statement here
-        } else {
-            // TODO: Error
+internal key_event
+UnknownSequence(input_decoder* Decoder) {
+    key_event Result = {};
+    Result.Type = KeyUnknownSequence;
+    memcpy(Decoder->Unknown, Decoder->Sequence, Decoder->SequenceLength);
+    Result.Sequence = StringWithLength(Decoder->Unknown, Decoder->SequenceLength);
+    return Result;
+}
+
+// Keys that are the same after ESC [ and ESC O (ex. the arrows)
+internal key_type
+CursorKeyType(char Final) {
+    key_type Result = KeyNone;
+    switch(Final) {
+        case 'A': Result = KeyUp;    break;
+        case 'B': Result = KeyDown;  break;
+        case 'C': Result = KeyRight; break;
+        case 'D': Result = KeyLeft;  break;
+        case 'H': Result = KeyHome;  break;
+        case 'F': Result = KeyEnd;   break;
+        default: break;
+    }
+    return Result;
+}
+
+internal key_event
+DispatchSequence(input_decoder* Decoder, b32 IsCSI) {
+    key_event Result = {};
+    char Final = Decoder->Sequence[Decoder->SequenceLength - 1];
+
+    if(IsCSI && Decoder->IsPrivate) {
+        if((Final == 'M' || Final == 'm') && Decoder->NumParameters == 3) {
+            // ESC [ < button ; x ; y M, with m when the button is let go
+            Result.Type = KeyMouse;
+            Result.MouseButton = Decoder->Parameters[0];
+            Result.MouseX = Decoder->Parameters[1];
+            Result.MouseY = Decoder->Parameters[2];
+            Result.MouseReleased = (Final == 'm');
         }
-    } else if(FileDescriptor == STDIN_FILENO) {
-        // printf("\r\nstdin read\r\n");
-        if(read(STDIN_FILENO, &Result, 1) > 0){
-            // ???
-        } else {
-            // TODO: Error
+    } else if(Final == '~' && IsCSI) {
+        switch(SequenceParameter(Decoder, 0, 0)) {
+            case 1: case 7: Result.Type = KeyHome;     break;
+            case 2:         Result.Type = KeyInsert;   break;
+            case 3:         Result.Type = KeyDelete;   break;
+            case 4: case 8: Result.Type = KeyEnd;      break;
+            case 5:         Result.Type = KeyPageUp;   break;
+            case 6:         Result.Type = KeyPageDown; break;
+            default: break;
         }
+        Result.Modifiers = SequenceParameter(Decoder, 1, 1) - 1;
+    } else {
+        // ESC [ 1 ; 5 A is Ctrl-Up
+        Result.Type = CursorKeyType(Final);
+        Result.Modifiers = SequenceParameter(Decoder, 1, 1) - 1;
     }
 
-
+    if(Result.Type == KeyNone) {
+        Result = UnknownSequence(Decoder);
+    }
     return Result;
 }
 
-internal pipe_fds
-CreatePipe(b32 Blocking = false) {
-    union {
-        s32 Pipe[2];
-        pipe_fds FileDescriptors;
-    } Result = {};
+// Runs one byte through the state machine. Returns a key once one is complete.
+internal key_event
+DecodeInputByte(input_decoder* Decoder, u8 Byte) {
+    key_event Result = {};
+    input_transition Transition = InputTables.Transitions[Decoder->State][InputTables.Classes[Byte]];
 
-    // TODO: Look into O_DIRECT for "packet mode"
-    s32 Flags = 0;
-    if(!Blocking) {
-        Flags |= O_NONBLOCK;
+    if(Decoder->State != InputGround && Decoder->SequenceLength < MaxSequenceLength) {
+        Decoder->Sequence[Decoder->SequenceLength++] = Byte;
     }
 
-    pipe2(Result.Pipe, Flags);
-    InternalMessagePipeExists = true;
+    switch(Transition.Action) {
+        case InputActionKey: {
+            Result.Type = KeyChar;
+            Result.Char = Byte;
+        } break;
+
+        case InputActionEscapeKey: {
+            Result.Type = KeyEscape;
+            // The second ESC starts a sequence
+        } [[fallthrough]];
+
+        case InputActionStart: {
+            Decoder->IsPrivate = false;
+            Decoder->NumParameters = 0;
+            Decoder->Sequence[0] = Byte;
+            Decoder->SequenceLength = 1;
+        } break;
+
+        case InputActionCollect: break;
+
+        case InputActionDigit: {
+            if(Decoder->NumParameters == 0) {
+                Decoder->NumParameters = 1;
+                Decoder->Parameters[0] = 0;
+            }
+            s32* Parameter = &Decoder->Parameters[Decoder->NumParameters - 1];
+            if(*Parameter < 100000) {
+                *Parameter = *Parameter * 10 + (Byte - '0');
+            }
+        } break;
+
+        case InputActionParameter: {
+            if(Decoder->NumParameters == 0) {
+                // Leading ';' means the first parameter was left out
+                Decoder->Parameters[Decoder->NumParameters++] = 0;
+            }
+            if(Decoder->NumParameters < MaxSequenceParameters) {
+                Decoder->Parameters[Decoder->NumParameters++] = 0;
+            }
+        } break;
+
+        case InputActionPrivate: {
+            Decoder->IsPrivate = true;
+        } break;
+
+        case InputActionAlt: {
+            Result.Type = KeyAlt;
+            Result.Char = Byte;
+        } break;
+
+        case InputActionDispatchCSI: {
+            Result = DispatchSequence(Decoder, true);
+        } break;
+
+        case InputActionDispatchSS3: {
+            Result = DispatchSequence(Decoder, false);
+        } break;
+
+        case InputActionUnknown: {
+            Result = UnknownSequence(Decoder);
+            if(Transition.Next == InputEscape) {
+                // The ESC that cut the sequence short starts the next one
+                Decoder->IsPrivate = false;
+                Decoder->NumParameters = 0;
+                Decoder->Sequence[0] = Byte;
+                Decoder->SequenceLength = 1;
+            }
+        } break;
+    }
 
-    return Result.FileDescriptors;
+    Decoder->State = Transition.Next;
+    return Result;
 }
 
-internal void
-DestroyPipe(pipe_fds Pipe) {
-    close(Pipe.ReadHead);
-    close(Pipe.WriteHead);
+// Blocks until a whole key has come in
+internal key_event
+ReadKey() {
+    input_decoder* Decoder = &InputDecoder;
+    key_event Result = {};
+
+    while(Result.Type == KeyNone) {
+        if(Decoder->PendingTerminate) {
+            Decoder->PendingTerminate = false;
+            Result.Type = KeyTerminate;
+        } else if(Decoder->PendingInterrupts > 0) {
+            --Decoder->PendingInterrupts;
+            Result.Type = KeyInterrupt;
+        } else if(Decoder->PendingResizes > 0) {
+            --Decoder->PendingResizes;
+            Result.Type = KeyWindowResized;
+        } else if(Decoder->PendingFrame) {
+            Decoder->PendingFrame = false;
+            Result.Type = KeyFrame;
+        } else if(Decoder->ReadIndex != Decoder->WriteIndex) {
+            u8 Byte = Decoder->Ring[Decoder->ReadIndex++ & (InputRingSize - 1)];
+            Result = DecodeInputByte(Decoder, Byte);
+            if(Decoder->State == InputGround && (Decoder->TimerArmed || Decoder->TimedOut)) {
+                SetEscapeTimer(Decoder, 0);
+            }
+        } else if(Decoder->State == InputGround) {
+            WaitForInput(Decoder);
+        } else if(Decoder->TimedOut) {
+            // Nothing else came, so the sequence was cut short
+            if(Decoder->State == InputEscape) {
+                Result.Type = KeyEscape;
+            } else {
+                Result = UnknownSequence(Decoder);
+            }
+            Decoder->State = InputGround;
+            Decoder->TimedOut = false;
+        } else {
+            if(!Decoder->TimerArmed) {
+                SetEscapeTimer(Decoder, EscapeSequenceTimeoutMS);
+            }
+            WaitForInput(Decoder);
+        }
+    }
+
+    return Result;
 }
 
 // NOTE: Below are the functions that interact with vt100. The only thing
-// they rely on from the code above is the global InternalMessagePipe variable.
+// they rely on from the code above is the global Output buffer.
 
 struct vector2_i {
     s32 X, Y;
 };
 
-global struct termios   OriginalTermIOs;
-global struct sigaction OldResizeAction;
+global struct termios OriginalTermIOs;
 
 internal void
 DisableRawMode() {
@@ -161,11 +579,8 @@ EnableRawMode() {
 
 internal void
 EnableMouseTracking() {
-    char MouseTracking[] = "\x1b[1000h";
-    write(STDOUT_FILENO, MouseTracking, sizeof(MouseTracking) - 1);
-
-    char DecimalMouseTracking[] = "\x1b[1006h";
-    write(STDOUT_FILENO, DecimalMouseTracking, sizeof(DecimalMouseTracking) - 1);
+    WriteLiteral(&Output, "\x1b[1000h");
+    WriteLiteral(&Output, "\x1b[1006h"); // Decimal coordinates
 }
 
 internal vector2_i
@@ -173,8 +588,8 @@ GetWindowSize() {
     vector2_i Result = {};
     struct winsize WindowSize;
     if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &WindowSize) != -1 && WindowSize.ws_col != 0) {
-        Result.Y = WindowSize.ws_col;
-        Result.X = WindowSize.ws_row;
+        Result.X = WindowSize.ws_col;
+        Result.Y = WindowSize.ws_row;
     }
 
     return Result;
@@ -189,62 +604,54 @@ IsTerminal(s32 FileDescriptor) {
     return Result;
 }
 
+// SIGWINCH, SIGINT and SIGTERM are blocked and come to ReadKey as events
+// instead. Threads started after this inherit the mask, so none of them get
+// the signals either.
 internal void
-ResizeSignalHandler(s32 Signal) {
-    s32 Value = WindowResized;
-    write(InternalMessagePipe.WriteHead, &Value, sizeof(Value));
+StartSignalHandling() {
+    sigset_t SignalSet;
+    sigemptyset(&SignalSet);
+    sigaddset(&SignalSet, SIGWINCH);
+    sigaddset(&SignalSet, SIGINT);
+    sigaddset(&SignalSet, SIGTERM);
+
+    if(pthread_sigmask(SIG_BLOCK, &SignalSet, NULL) == 0) {
+        SignalFileDescriptor = signalfd(-1, &SignalSet, SFD_NONBLOCK | SFD_CLOEXEC);
+        if(SignalFileDescriptor >= 0) {
+            RegisterFDForEPollRead(SignalFileDescriptor);
+        } else {
+            pthread_sigmask(SIG_UNBLOCK, &SignalSet, NULL);
+        }
+    }
 }
 
 internal void
-StartResizeHandling() {
-    struct sigaction Action = {};
-    Action.sa_handler = ResizeSignalHandler;
-
-    sigaction(SIGWINCH, &Action, &OldResizeAction);
-
-    if(!InternalMessagePipeExists) {
-        // uninitialized
-        InternalMessagePipe = CreatePipe();
-        InternalMessagePipeExists = true;
-    }
-
-    RegisterFDForEPollRead(InternalMessagePipe.ReadHead);
-    // SetMaxFileDescriptor(InternalMessagePipe.ReadHead);
-    // FD_SET(InternalMessagePipe.ReadHead, &ReadFileDescriptors);
-
-    // NOTE: The docs say that you can do this or use pselect with the SignalSet as the last argument.
-    //       I was not able to get this working. After trying both methods the result was the program
-    //       waiting until one of the file descriptors read something and only then returning.
-    // sigset_t SignalSet;
-    // sigemptyset(&SignalSet);
-    // sigaddset(&SignalSet, SIGWINCH);
-
-    // sigprocmask(SIG_BLOCK, &SignalSet, NULL);
+ClearToEndOfLine() {
+    WriteLiteral(&Output, "\x1b[0K");
 }
 
 internal void
-ClearToEndOfLine() {
-    char ClearCommand[] = "\x1b[0K";
-    write(STDOUT_FILENO, ClearCommand, sizeof(ClearCommand) - 1);
+ClearToEndOfScreen() {
+    WriteLiteral(&Output, "\x1b[0J");
 }
 
 internal void
 ClearScreen() {
-    char ClearCommand[] = "\x1b[2J";
-    write(STDOUT_FILENO, ClearCommand, sizeof(ClearCommand) - 1);
+    WriteLiteral(&Output, "\x1b[2J");
 }
 
 internal void
 MoveCursorTo(vector2_i Position) {
-    char Buffer[32] = {};
-    snprintf(Buffer, sizeof(Buffer), "\x1b[%d;%df", Position.Y, Position.X);
-    write(STDOUT_FILENO, Buffer, CStringLength(Buffer));
+    WriteLiteral(&Output, "\x1b[");
+    WriteInt(&Output, Position.Y);
+    WriteByte(&Output, ';');
+    WriteInt(&Output, Position.X);
+    WriteByte(&Output, 'f');
 }
 
 internal void
 MoveCursorToTop() {
-    char Buffer[] = "\x1b[1;1f";
-    write(STDOUT_FILENO, Buffer, sizeof(Buffer) - 1);
+    WriteLiteral(&Output, "\x1b[1;1f");
 }
 
 internal void
@@ -255,11 +662,9 @@ MoveCursorByAmountInDirection(s32 NumPositions, char ForwardChar, char BackwardC
             Char = BackwardChar;
             NumPositions = -NumPositions;
         }
-        char Buffer[32] = {};
-        snprintf(Buffer, sizeof(Buffer), "\x1b[%d%c", NumPositions, Char);
-
-        s32 StringLength = CStringLength(Buffer);
-        write(STDOUT_FILENO, Buffer, StringLength);
+        WriteLiteral(&Output, "\x1b[");
+        WriteInt(&Output, NumPositions);
+        WriteByte(&Output, Char);
     }
 }
 
@@ -279,30 +684,54 @@ MoveCursorBy(vector2_i Vec) {
     MoveCursorByY(Vec.Y);
 }
 
+// Moves between two columns of text that started at the left edge and wrapped
+// onto a new row every Width columns. A Width of 0 means it didn't wrap.
+internal void
+MoveCursorInWrappedText(int_size From, int_size To, s32 Width) {
+    if(Width > 0) {
+        MoveCursorByY((s32)(To / Width - From / Width));
+        MoveCursorByX((s32)(To % Width - From % Width));
+    } else {
+        MoveCursorByX((s32)(To - From));
+    }
+}
+
+// Call after writing wrapped text that ends at column End. Terminals leave the
+// cursor on the last column until another character comes, so text that fills
+// its last row moves the cursor down itself to keep it where the columns say.
+internal void
+FinishWrappedText(int_size End, s32 Width) {
+    if(Width > 0 && End > 0 && End % Width == 0) {
+        WriteLiteral(&Output, "\r\n");
+    }
+}
+
 internal void
 SaveScreenState() {
     // Save cursor position
-    char const SaveCursorString[] = "\x1b" "7";
-    write(STDOUT_FILENO, SaveCursorString, sizeof(SaveCursorString) - 1);
+    WriteLiteral(&Output, "\x1b" "7");
 
     // Save screen contents
-    char const SaveString[] = "\x1b[?47h";
-    write(STDOUT_FILENO, SaveString, sizeof(SaveString) - 1);
+    WriteLiteral(&Output, "\x1b[?47h");
 }
 
 internal void
 RestoreScreenState() {
     // Restore screen contents
-    char const RestoreString[] =  "\x1b[?47l";
-    write(STDOUT_FILENO, RestoreString, sizeof(RestoreString) - 1);
+    WriteLiteral(&Output, "\x1b[?47l");
 
     // Restore cursor position
-    char const RestoreCursorString[] = "\x1b" "8";
-    write(STDOUT_FILENO, RestoreCursorString, sizeof(RestoreCursorString) - 1);
+    WriteLiteral(&Output, "\x1b" "8");
 }
 
 internal void
 InitVT100UI() {
-    EPollFileDescriptor = epoll_create(1); // Argument is ignored
+    InitEPoll();
     RegisterFDForEPollRead(STDIN_FILENO);
+
+    EscapeTimerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    RegisterFDForEPollRead(EscapeTimerFileDescriptor);
+
+    FrameTimerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    RegisterFDForEPollRead(FrameTimerFileDescriptor);
 }